@@ -341,6 +341,9 @@ FileSystem::Remove(const char *name)
     fileHdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
     directory->Remove(name);
+#ifdef USER_PROGRAM
+    execCache->Invalidate(sector);		// the sector can be reused
+#endif
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
     directory->WriteBack(directoryFile);        // flush to disk
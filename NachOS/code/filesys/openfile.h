@@ -32,12 +32,10 @@ class OpenFile {
     ~OpenFile() { Close(file); }			// close the file
 
     int ReadAt(char *into, int numBytes, int position) { 
-    		Lseek(file, position, 0); 
-		return ReadPartial(file, into, numBytes); 
+		return ReadPartialAt(file, into, numBytes, position); 
 		}	
     int WriteAt(const char *from, int numBytes, int position) { 
-    		Lseek(file, position, 0); 
-		WriteFile(file, from, numBytes); 
+		WriteFileAt(file, from, numBytes, position); 
 		return numBytes;
 		}	
     int Read(char *into, int numBytes) {
@@ -51,7 +49,10 @@ class OpenFile {
 		return numWritten;
 		}
 
-    int Length() { Lseek(file, 0, 2); return Tell(file); }
+    int Length() { return FileLength(file); }
+
+    int HeaderSector() { return FileId(file); }	// no header sector on
+					// UNIX, the inode number plays its role
     
   private:
     int file;
@@ -85,9 +86,12 @@ class OpenFile {
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
+
+    int HeaderSector() { return hdrSector; } // Identifies the file
     
   private:
     FileHeader *hdr;			// Header for this file 
+    int hdrSector;			// Where hdr is located on disk
     int seekPosition;			// Current position within the file
 };
 
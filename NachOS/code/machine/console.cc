@@ -20,6 +20,8 @@
 // Dummy functions because C++ is weird about pointers to member functions
 static void ConsoleReadPoll(int c) 
 { Console *console = (Console *)c; console->CheckCharAvail(); }
+static void ConsoleInputReady(int c)	// characters were typed
+{ interrupt->Schedule(ConsoleReadPoll, c, ConsoleTime, ConsoleReadInt); }
 static void ConsoleWriteDone(int c)
 { Console *console = (Console *)c; console->WriteDone(); }
 
@@ -53,10 +55,15 @@ Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
     readHandler = readAvail;
     handlerArg = callArg;
     putBusy = FALSE;
-    incoming = EOF;
+    burst = 1;
+    inputEnded = FALSE;
+    readStalled = FALSE;
+    inHead = inCount = 0;
+    outHead = outCount = 0;
+    outBurst = 0;
 
-    // start polling for incoming packets
-    interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, ConsoleReadInt);
+    // be told when characters are typed
+    interrupt->WatchInput(readFileNo, ConsoleInputReady, (int)this);
 }
 
 //----------------------------------------------------------------------
@@ -66,59 +73,113 @@ Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
 
 Console::~Console()
 {
+    interrupt->UnwatchInput(readFileNo);
     if (readFileNo != 0)
 	Close(readFileNo);
     if (writeFileNo != 1)
 	Close(writeFileNo);
 }
 
+//----------------------------------------------------------------------
+// Console::SetBurst
+// 	Move up to "n" characters per interrupt, instead of one.
+//----------------------------------------------------------------------
+
+void
+Console::SetBurst(int n)
+{
+    ASSERT(n > 0 && n <= ConsoleBufferSize);
+    burst = n;
+}
+
 //----------------------------------------------------------------------
 // Console::CheckCharAvail()
-// 	Periodically called to check if a character is available for
-//	input from the simulated keyboard (eg, has it been typed?).
+// 	Called ConsoleTime after characters were typed on the simulated
+//	keyboard, to read them in.
 //
-//	Only read it in if there is buffer space for it (if the previous
-//	character has been grabbed out of the buffer by the Nachos kernel).
-//	Invoke the "read" interrupt handler, once the character has been 
-//	put into the buffer. 
+//	Read in as many as there is room for in the input buffer, up
+//	to a burst.  Invoke the "read" interrupt handler once they are
+//	in the buffer, or once the end of the input is reached.  Then
+//	wait for more input, or for room in the buffer if it is full.
 //----------------------------------------------------------------------
 
 void
 Console::CheckCharAvail()
 {
-    char c;
-    int n;
-
-    // schedule the next time to poll for a packet
-    interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, 
-			ConsoleReadInt);
+    int n, tail;
 
-    // do nothing if character is already buffered, or none to be read
-    if ((incoming != EOF) || !PollFile(readFileNo))
+    if (inCount == ConsoleBufferSize) {	// GetBuffer will arm again
+	readStalled = TRUE;
+	return;
+    }
+    if (!PollFile(readFileNo)) {
+	interrupt->ArmInput(readFileNo);
 	return;	  
+    }
 
-    // otherwise, read character and tell user about it
-    n = ReadPartial(readFileNo, &c, sizeof(char));
-    incoming = (n == 1 ? c : EOF);
-    stats->numConsoleCharsRead++;
+    // read as much as fits before the end of the ring
+    tail = (inHead + inCount) % ConsoleBufferSize;
+    n = ConsoleBufferSize - inCount;
+    if (n > ConsoleBufferSize - tail)
+	n = ConsoleBufferSize - tail;
+    if (n > burst)
+	n = burst;
+    n = ReadPartial(readFileNo, &inBuf[tail], n);
+    if (n <= 0)
+	inputEnded = TRUE;	// nothing more will come, stop watching
+    else {
+	inCount += n;
+	stats->numConsoleCharsRead += n;
+	interrupt->ArmInput(readFileNo);
+    }
     (*readHandler)(handlerArg);	
 }
 
 //----------------------------------------------------------------------
 // Console::WriteDone()
 // 	Internal routine called when it is time to invoke the interrupt
-//	handler to tell the Nachos kernel that the output character has
-//	completed.
+//	handler to tell the Nachos kernel that the output burst has
+//	completed, and room was made in the output buffer.
 //----------------------------------------------------------------------
 
 void
 Console::WriteDone()
 {
     putBusy = FALSE;
-    stats->numConsoleCharsWritten++;
+    stats->numConsoleCharsWritten += outBurst;
+    outBurst = 0;
+    StartBurst();
     (*writeHandler)(handlerArg);
 }
 
+//----------------------------------------------------------------------
+// Console::StartBurst()
+// 	Send the next characters of the output buffer to the display,
+//	as many as are contiguous in the ring, up to a burst, and
+//	schedule the interrupt telling they are gone.
+//----------------------------------------------------------------------
+
+void
+Console::StartBurst()
+{
+    int n;
+
+    if (putBusy || outCount == 0)
+	return;
+    n = outCount;
+    if (n > ConsoleBufferSize - outHead)
+	n = ConsoleBufferSize - outHead;
+    if (n > burst)
+	n = burst;
+    WriteFile(writeFileNo, &outBuf[outHead], n);
+    outHead = (outHead + n) % ConsoleBufferSize;
+    outCount -= n;
+    outBurst = n;
+    putBusy = TRUE;
+    interrupt->Schedule(ConsoleWriteDone, (int)this, ConsoleTime,
+					ConsoleWriteInt);
+}
+
 //----------------------------------------------------------------------
 // Console::GetChar()
 // 	Read a character from the input buffer, if there is any there.
@@ -128,10 +189,39 @@ Console::WriteDone()
 char
 Console::GetChar()
 {
-   char ch = incoming;
+    char ch;
 
-   incoming = EOF;
-   return ch;
+    if (GetBuffer(&ch, 1) == 0)
+	return EOF;
+    return ch;
+}
+
+//----------------------------------------------------------------------
+// Console::GetBuffer()
+// 	Take up to "n" characters from the input buffer, stopping after
+//	a newline or a '\0', so that a line is never split between two
+//	readers.  Return the number of characters taken.
+//----------------------------------------------------------------------
+
+int
+Console::GetBuffer(char *buf, int n)
+{
+    int i = 0;
+    char ch;
+
+    while (i < n && inCount > 0) {
+	ch = inBuf[inHead];
+	inHead = (inHead + 1) % ConsoleBufferSize;
+	inCount--;
+	buf[i++] = ch;
+	if (ch == '\n' || ch == '\0')
+	    break;
+    }
+    if (i > 0 && readStalled) {		// room again for the input left
+	readStalled = FALSE;
+	interrupt->ArmInput(readFileNo);
+    }
+    return i;
 }
 
 //----------------------------------------------------------------------
@@ -143,16 +233,61 @@ Console::GetChar()
 void
 Console::PutChar(char ch)
 {
-    ASSERT(putBusy == FALSE);
-    WriteFile(writeFileNo, &ch, sizeof(char));
-    putBusy = TRUE;
-    interrupt->Schedule(ConsoleWriteDone, (int)this, ConsoleTime,
-					ConsoleWriteInt);
+    ASSERT(outCount < ConsoleBufferSize);
+    PutBuffer(&ch, 1);
+}
+
+//----------------------------------------------------------------------
+// Console::PutBuffer()
+// 	Queue up to "n" characters of "buf" for the display, and start
+//	sending them if the display is idle.  "writeHandler" is called
+//	after each burst.  Return the number of characters queued, 0 if
+//	the output buffer is full.
+//----------------------------------------------------------------------
+
+int
+Console::PutBuffer(const char *buf, int n)
+{
+    int i;
+
+    for (i = 0; i < n && outCount < ConsoleBufferSize; i++) {
+	outBuf[(outHead + outCount) % ConsoleBufferSize] = buf[i];
+	outCount++;
+    }
+    StartBurst();
+    return i;
 }
 
+//----------------------------------------------------------------------
+// Console::OutputIdle()
+// 	Have all the characters put been sent to the display?
+//----------------------------------------------------------------------
+
+bool
+Console::OutputIdle()
+{
+    return !putBusy && outCount == 0;
+}
+
+//----------------------------------------------------------------------
+// Console::InputReady()
+// 	Are there characters to read, or has the input ended?  Either
+//	way, GetBuffer followed by feof would not have to wait.
+//----------------------------------------------------------------------
+
+bool
+Console::InputReady()
+{
+    return inCount > 0 || inputEnded;
+}
+
+//----------------------------------------------------------------------
+// Console::feof()
+// 	Has the input reached its end, everything buffered being read?
+//----------------------------------------------------------------------
+
 int
 Console::feof()
 {
-    return incoming == EOF;
-    
+    return inputEnded && inCount == 0;
 }
@@ -14,6 +14,11 @@
 //	for read and write, and the device is "duplex" -- a character
 //	can be outgoing and incoming at the same time.
 //
+//	The device has a ring buffer each way, and moves up to "burst"
+//	characters per interrupt (1 unless SetBurst is called).  The read
+//	interrupt comes when characters were added to the input buffer,
+//	the write interrupt when some were sent from the output buffer.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -26,6 +31,8 @@
 #include "copyright.h"
 #include "utility.h"
 
+#define ConsoleBufferSize 256	// bytes of each ring buffer
+
 // The following class defines a hardware console device.
 // Input and output to the device is simulated by reading
 // and writing to UNIX files ("readFile" and "writeFile").
@@ -52,6 +59,16 @@ class Console {
     				// "readHandler" is called whenever there is
 				// a char to be gotten
 
+    int PutBuffer(const char *buf, int n); // Queue up to "n" chars
+				// for the display, as many as fit in the
+				// output buffer, return how many
+    int GetBuffer(char *buf, int n); // Take up to "n" buffered chars,
+				// stopping after a newline or a '\0', return
+				// how many
+    void SetBurst(int n);	// chars moved per interrupt each way
+    bool OutputIdle();		// everything put has been sent
+    bool InputReady();		// GetBuffer would return at once
+
 // internal emulation routines -- DO NOT call these.
     void WriteDone();	 	// internal routines to signal I/O completion
     void CheckCharAvail();
@@ -67,11 +84,19 @@ class Console {
 					// a character arrives from the keyboard
     int handlerArg;			// argument to be passed to the
 					// interrupt handlers
-    bool putBusy;    			// Is a PutChar operation in progress?
-					// If so, you can't do another one!
-    char incoming;    			// Contains the character to be read,
-					// if there is one available.
-					// Otherwise contains EOF.
+    bool putBusy;    			// Is a burst being sent?
+    int burst;				// chars per interrupt
+    bool inputEnded;			// the keyboard file reached its end
+    bool readStalled;			// input left unread, the buffer
+					// being full
+
+    char inBuf[ConsoleBufferSize];	// received, not yet gotten
+    int inHead, inCount;
+    char outBuf[ConsoleBufferSize];	// put, not yet sent
+    int outHead, outCount;
+    int outBurst;			// chars of the burst being sent
+
+    void StartBurst();			// send the next burst, if any
 };
 
 #endif // CONSOLE_H
@@ -53,16 +53,16 @@ Disk::Disk(const char* name, VoidFunctionPtr callWhenDone, int callArg)
     
     fileno = OpenForReadWrite(name, FALSE);
     if (fileno >= 0) {		 	// file exists, check magic number 
-	Read(fileno, (char *) &magicNum, MagicSize);
+	ReadFileAt(fileno, (char *) &magicNum, MagicSize, 0);
 	ASSERT(magicNum == MagicNumber);
     } else {				// file doesn't exist, create it
         fileno = OpenForWrite(name);
 	magicNum = MagicNumber;  
-	WriteFile(fileno, (char *) &magicNum, MagicSize); // write magic number
+	WriteFileAt(fileno, (char *) &magicNum, MagicSize, 0);
+						// write magic number
 
 	// need to write at end of file, so that reads will not return EOF
-        Lseek(fileno, DiskSize - sizeof(int), 0);	
-	WriteFile(fileno, (char *)&tmp, sizeof(int));  
+	WriteFileAt(fileno, (char *)&tmp, sizeof(int), DiskSize - sizeof(int));
     }
     active = FALSE;
 }
@@ -100,7 +100,8 @@ PrintSector (bool writing, int sector, char *data)
 //----------------------------------------------------------------------
 // Disk::ReadRequest/WriteRequest
 // 	Simulate a request to read/write a single disk sector
-//	   Do the read/write immediately to the UNIX file
+//	   Do the read/write immediately to the UNIX file, at the
+//	      position of the sector: one host system call
 //	   Set up an interrupt handler to be called later,
 //	      that will notify the caller when the simulator says
 //	      the operation has completed.
@@ -121,8 +122,7 @@ Disk::ReadRequest(int sectorNumber, char* data)
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
     
     DEBUG('d', "Reading from sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
+    ReadFileAt(fileno, data, SectorSize, SectorSize * sectorNumber + MagicSize);
     if (DebugIsEnabled('d'))
 	PrintSector(FALSE, sectorNumber, data);
     
@@ -141,8 +141,7 @@ Disk::WriteRequest(int sectorNumber, char* data)
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
     
     DEBUG('d', "Writing to sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
+    WriteFileAt(fileno, data, SectorSize, SectorSize * sectorNumber + MagicSize);
     if (DebugIsEnabled('d'))
 	PrintSector(TRUE, sectorNumber, data);
     
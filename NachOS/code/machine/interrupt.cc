@@ -28,7 +28,12 @@
 
 static const char *intLevelNames[] = { "off", "on"};
 static const char *intTypeNames[] = { "timer", "disk", "console write", 
-			"console read", "network send", "network recv"};
+			"console read", "network send", "network recv",
+			"network timer"};
+
+// Set by the host signal telling that input arrived on a watched file
+static volatile bool inputSignaled = FALSE;
+static void InputSignal() { inputSignaled = TRUE; }
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -64,6 +69,8 @@ Interrupt::Interrupt()
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
+    watches = NULL;
+    CallOnInput(InputSignal);
 }
 
 //----------------------------------------------------------------------
@@ -79,6 +86,8 @@ Interrupt::~Interrupt()
        delete (PendingInterrupt *)(pending->Remove());
     // End of correction 
     delete pending;
+    while (watches != NULL)
+	UnwatchInput(watches->fd);
 }
 
 //----------------------------------------------------------------------
@@ -169,6 +178,10 @@ Interrupt::OneTick()
     ChangeLevel(IntOn, IntOff);		// first, turn off interrupts
 					// (interrupt handlers run with
 					// interrupts disabled)
+    if (inputSignaled) {		// only look at the files when
+	inputSignaled = FALSE;		// the host said something arrived
+	CheckInput(0);
+    }
     while (CheckIfDue(FALSE))		// check for pending interrupts
 	;
     ChangeLevel(IntOff, IntOn);		// re-enable interrupts
@@ -215,20 +228,28 @@ Interrupt::Idle()
 {
     DEBUG('i', "Machine idling; checking for interrupts.\n");
     status = IdleMode;
-    if (CheckIfDue(TRUE)) {		// check for any pending interrupts
-    	while (CheckIfDue(FALSE))	// check for any other pending 
-	    ;				// interrupts
-        yieldOnReturn = FALSE;		// since there's nothing in the
+    for (;;) {
+	if (inputSignaled) {
+	    inputSignaled = FALSE;
+	    CheckInput(0);
+	}
+	if (CheckIfDue(TRUE)) {		// check for any pending interrupts
+	    while (CheckIfDue(FALSE))	// check for any other pending 
+		;			// interrupts
+	    yieldOnReturn = FALSE;	// since there's nothing in the
 					// ready queue, the yield is automatic
-        status = SystemMode;
-	return;				// return in case there's now
+	    status = SystemMode;
+	    return;			// return in case there's now
 					// a runnable thread
+	}
+	// nothing scheduled: block the host process until input
+	// arrives on a file a device waits on, if there is one
+	if (!CheckInput(-1))
+	    break;
     }
 
-    // if there are no pending interrupts, and nothing is on the ready
-    // queue, it is time to stop.   If the console or the network is 
-    // operating, there are *always* pending interrupts, so this code
-    // is not reached.  Instead, the halt must be invoked by the user program.
+    // if there are no pending interrupts, no device waiting for input,
+    // and nothing is on the ready queue, it is time to stop.
 
     DEBUG('i', "Machine idle.  No interrupts to do.\n");
     printf("No threads ready or runnable, and no pending interrupts.\n");
@@ -236,6 +257,116 @@ Interrupt::Idle()
     Halt();
 }
 
+//----------------------------------------------------------------------
+// Interrupt::WatchInput
+// 	A device reads its input from the host file "fd": call
+//	"handler(arg)" when there is some, once per ArmInput.  The file
+//	starts armed.
+//----------------------------------------------------------------------
+
+void
+Interrupt::WatchInput(int fd, VoidFunctionPtr handler, int arg)
+{
+    InputWatch *watch = new InputWatch;
+
+    watch->fd = fd;
+    watch->handler = handler;
+    watch->arg = arg;
+    watch->armed = FALSE;
+    watch->next = watches;
+    watches = watch;
+    NotifyOnInput(fd, TRUE);
+    ArmInput(fd);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::UnwatchInput
+// 	The device does not read "fd" anymore.
+//----------------------------------------------------------------------
+
+void
+Interrupt::UnwatchInput(int fd)
+{
+    InputWatch **link, *watch;
+
+    for (link = &watches; *link != NULL; link = &(*link)->next)
+	if ((*link)->fd == fd) {
+	    watch = *link;
+	    *link = watch->next;
+	    NotifyOnInput(fd, FALSE);
+	    delete watch;
+	    return;
+	}
+}
+
+//----------------------------------------------------------------------
+// Interrupt::ArmInput
+// 	The device waits for input on "fd".  The file is checked once
+//	now, as the input may have arrived before (and a regular file
+//	never signals); otherwise the handler is called when the host
+//	signals new input.
+//----------------------------------------------------------------------
+
+void
+Interrupt::ArmInput(int fd)
+{
+    InputWatch *watch;
+    bool ready;
+
+    for (watch = watches; watch != NULL; watch = watch->next)
+	if (watch->fd == fd)
+	    break;
+    ASSERT(watch != NULL);
+    watch->armed = TRUE;		// before looking, not to miss a signal
+    if (WaitForFiles(&fd, 1, &ready, 0) > 0 && watch->armed) {
+	watch->armed = FALSE;
+	(*watch->handler)(watch->arg);
+    }
+}
+
+//----------------------------------------------------------------------
+// Interrupt::CheckInput
+// 	Look at all the armed files at once, waiting up to "timeout"
+//	milliseconds (-1: until something arrives), and call the handlers
+//	of the ones with input.  Return FALSE if no file is armed.
+//----------------------------------------------------------------------
+
+bool
+Interrupt::CheckInput(int timeout)
+{
+    InputWatch *watch;
+    int numArmed = 0, i;
+    int *fds;
+    bool *ready;
+
+    for (watch = watches; watch != NULL; watch = watch->next)
+	if (watch->armed)
+	    numArmed++;
+    if (numArmed == 0)
+	return FALSE;
+
+    fds = new int[numArmed];
+    ready = new bool[numArmed];
+    i = 0;
+    for (watch = watches; watch != NULL; watch = watch->next)
+	if (watch->armed)
+	    fds[i++] = watch->fd;
+    DEBUG('i', "Waiting for input on %d files\n", numArmed);
+    if (WaitForFiles(fds, numArmed, ready, timeout) > 0)
+	for (i = 0; i < numArmed; i++) {
+	    if (!ready[i])
+		continue;
+	    for (watch = watches; watch != NULL; watch = watch->next)
+		if (watch->fd == fds[i] && watch->armed) {
+		    watch->armed = FALSE;
+		    (*watch->handler)(watch->arg);
+		}
+	}
+    delete [] fds;
+    delete [] ready;
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Halt
 // 	Shut down Nachos cleanly, printing out performance statistics.
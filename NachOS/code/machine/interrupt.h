@@ -50,7 +50,7 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 // In Nachos, we support a hardware timer device, a disk, a console
 // display and keyboard, and a network.
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
-				NetworkSendInt, NetworkRecvInt};
+				NetworkSendInt, NetworkRecvInt, NetworkTimerInt};
 
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
@@ -75,6 +75,16 @@ class PendingInterrupt {
 // or disabled, and any hardware interrupts that are scheduled to occur
 // in the future.
 
+// A host file a device reads its input from (see Interrupt::WatchInput)
+class InputWatch {
+  public:
+    int fd;
+    VoidFunctionPtr handler;	// called when input is there, if armed
+    int arg;
+    bool armed;			// the device waits for input
+    InputWatch *next;
+};
+
 class Interrupt {
   public:
     Interrupt();			// initialize the interrupt simulation
@@ -113,6 +123,15 @@ class Interrupt {
     
     void OneTick();       		// Advance simulated time
 
+    // Input devices are told when their host file has data, instead
+    // of polling it.  "handler" is called once per ArmInput, when
+    // input is available; it should only schedule the interrupt
+    // that reads it.  The device arms again once it has read
+    // everything it could.
+    void WatchInput(int fd, VoidFunctionPtr handler, int arg);
+    void UnwatchInput(int fd);
+    void ArmInput(int fd);
+
   private:
     IntStatus level;		// are interrupts enabled or disabled?
     List *pending;		// the list of interrupts scheduled
@@ -121,6 +140,7 @@ class Interrupt {
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
     MachineStatus status;	// idle, kernel mode, user mode
+    InputWatch *watches;	// files input devices read from
 
     // these functions are internal to the interrupt simulation code
 
@@ -129,6 +149,11 @@ class Interrupt {
 
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 	IntStatus now);  		// simulated time
+
+    bool CheckInput(int timeout);	// Call the handlers of the armed
+					// files with input, waiting up to
+					// "timeout" ms.  FALSE if none is
+					// armed.
 };
 
 #endif // INTERRRUPT_H
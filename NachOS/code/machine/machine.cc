@@ -44,6 +44,11 @@ void CheckEndian()
 #endif
 }
 
+int pageSize = DefaultPageSize;
+int numPhysPages = DefaultNumPhysPages;
+int tlbSize = TLBSize;
+int tlbWays = 0;
+
 //----------------------------------------------------------------------
 // Machine::Machine
 // 	Initialize the simulation of user program execution.
@@ -56,20 +61,35 @@ Machine::Machine(bool debug)
 {
     int i;
 
+    ASSERT (PageSize >= 4 && (PageSize & (PageSize - 1)) == 0);
+    ASSERT (NumPhysPages > 0);
+
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
 #ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
+    tlbNumWays = (tlbWays == 0) ? tlbSize : tlbWays;
+    ASSERT (tlbNumWays > 0 && tlbSize % tlbNumWays == 0);
+    tlbNumSets = tlbSize / tlbNumWays;
+    tlb = new TranslationEntry[tlbSize];
+    tlbLastUse = new unsigned int[tlbSize];
+    for (i = 0; i < tlbSize; i++) {
 	tlb[i].valid = FALSE;
+	tlb[i].huge = FALSE;
+	tlbLastUse[i] = 0;
+    }
     pageTable = NULL;
 #else	// use linear page table
     tlb = NULL;
+    tlbLastUse = NULL;
+    tlbNumSets = tlbNumWays = 0;
     pageTable = NULL;
 #endif
+    tlbClock = 0;
+    currentAsid = 0;
+    pageDirectory = NULL;
 
     singleStep = debug;
     CheckEndian();
@@ -83,8 +103,10 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
-    if (tlb != NULL)
+    if (tlb != NULL) {
         delete [] tlb;
+        delete [] tlbLastUse;
+    }
 }
 
 //----------------------------------------------------------------------
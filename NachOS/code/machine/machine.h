@@ -28,13 +28,30 @@
 
 // Definitions related to the size, and format of user memory
 
-#define PageSize 	SectorSize 	// set the page size equal to
+// The page size and the number of physical pages are chosen when Nachos
+// starts (-pgsz and -mem flags), they must not change once the Machine
+// has been created
+
+#define DefaultPageSize	SectorSize 	// set the page size equal to
 					// the disk sector size, for
 					// simplicity
+#define DefaultNumPhysPages 32
+
+extern int pageSize;			// a power of two
+extern int numPhysPages;
+extern int tlbSize;			// TLB entries
+extern int tlbWays;			// entries of each TLB set,
+					// 0 for a fully associative TLB
 
-#define NumPhysPages    32
+#define PageSize 	pageSize
+#define NumPhysPages    numPhysPages
 #define MemorySize 	(NumPhysPages * PageSize)
-#define TLBSize		4		// if there is a TLB, make it small
+#define TLBSize		4		// if there is a TLB, make it small,
+					// by default (-tlb flag)
+#define SecondLevelSize	64		// entries of each second-level table
+					// of a two-level page table
+#define HugePageFactor	16		// pages covered by a huge page entry,
+					// divides SecondLevelSize
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -131,6 +148,10 @@ class Machine {
     				// Read or write 1, 2, or 4 bytes of virtual 
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
+    bool ReadBlock(int addr, char *buffer, int size);
+    bool WriteBlock(int addr, const char *buffer, int size);
+				// Same for "size" bytes, copied a page at
+				// a time, for the kernel
     
     ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
     				// Translate an address, and check for 
@@ -142,6 +163,9 @@ class Machine {
     void RaiseException(ExceptionType which, int badVAddr);
 				// Trap to the Nachos kernel, because of a
 				// system call or other exception.  
+    bool RetryKernelAccess(ExceptionType which, int badVAddr);
+				// Let the kernel resolve a fault raised
+				// by its own access to user memory
 
     void Debugger();		// invoke the user program debugger
     void DumpState();		// print the user CPU and memory state 
@@ -178,9 +202,23 @@ class Machine {
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
+    int tlbNumSets;			// virtual page vpn can only be in the
+    int tlbNumWays;			// tlbNumWays entries of set
+					// vpn % tlbNumSets, starting at
+					// tlb[set * tlbNumWays]
+    unsigned int *tlbLastUse;		// when each entry was last hit, for
+					// the kernel replacement policy
+    unsigned int tlbClock;
+    unsigned int currentAsid;		// only the TLB entries tagged with
+					// it are used to translate
 
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
+    TranslationEntry **pageDirectory;	// two-level page table, used
+					// instead of pageTable if not NULL:
+					// entry vpn is at
+					// [vpn / SecondLevelSize]
+					// [vpn % SecondLevelSize]
 
   private:
     bool singleStep;		// drop back into the debugger after each
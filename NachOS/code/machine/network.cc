@@ -18,121 +18,292 @@ static void NetworkReadPoll(int arg)
 { Network *net = (Network *)arg; net->CheckPktAvail(); }
 static void NetworkSendDone(int arg)
 { Network *net = (Network *)arg; net->SendDone(); }
+static void NetworkArrive(int arg)
+{ Network *net = (Network *)arg; net->Arrive(); }
+static void NetworkInputReady(int arg)	// a packet arrived on the socket
+{ interrupt->Schedule(NetworkReadPoll, arg, NetworkTime, NetworkRecvInt); }
+
+int wireSize = DefaultWireSize;
+
+PacketBuffer *PacketBuffer::pool = NULL;
+
+PacketBuffer::PacketBuffer()
+{
+    data = new char[MaxWireSize];
+}
+
+// take a buffer from the pool, allocate one if it is empty
+PacketBuffer *
+PacketBuffer::Get()
+{
+    PacketBuffer *packet = pool;
+
+    if (packet != NULL)
+	pool = packet->next;
+    else
+	packet = new PacketBuffer;
+    packet->refCount = 1;
+    return packet;
+}
+
+// put the buffer back into the pool once nobody uses it
+void
+PacketBuffer::Release()
+{
+    ASSERT(refCount > 0);
+    if (--refCount > 0)
+	return;
+    next = pool;
+    pool = this;
+}
 
 // Initialize the network emulation
 //   addr is used to generate the socket name
 //   reliability says whether we drop packets to emulate unreliable links
 //   readAvail, writeDone, callArg -- analogous to console
+//   queueDepth, linkBandwidth, linkLatency -- the link, see network.h
 Network::Network(NetworkAddress addr, double reliability,
-	VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, int callArg)
+	VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, int callArg,
+	int queueDepth, int linkBandwidth, int linkLatency)
 {
     ident = addr;
-    if (reliability < 0) chanceToWork = 0;
-    else if (reliability > 1) chanceToWork = 1;
-    else chanceToWork = reliability;
 
     // set up the stuff to emulate asynchronous interrupts
     writeHandler = writeDone;
     readHandler = readAvail;
     handlerArg = callArg;
-    sendBusy = FALSE;
-    inHdr.length = 0;
+    ASSERT(queueDepth > 0 && linkBandwidth > 0 && linkLatency >= 0);
+    depth = queueDepth;
+    numQueued = 0;
+    if (reliability < 0) reliability = 0;
+    else if (reliability > 1) reliability = 1;
+    defaultLink.chanceToWork = reliability;
+    defaultLink.bandwidth = linkBandwidth;
+    defaultLink.latency = linkLatency;
+    defaultLink.linkFree = 0;
+    for (int i = 0; i < MaxMachines; i++)
+	links[i] = NULL;
+    inFlight = new List;
+    inPacket = NULL;
     
     sock = OpenSocket();
     sprintf(sockName, "SOCKET_%d", (int)addr);
     AssignNameToSocket(sockName, sock);		 // Bind socket to a filename 
 						 // in the current directory.
 
-    // start polling for incoming packets
-    interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
+    // be told when packets arrive
+    interrupt->WatchInput(sock, NetworkInputReady, (int)this);
 }
 
 Network::~Network()
 {
+    PacketBuffer *packet;
+
+    while ((packet = (PacketBuffer *) inFlight->Remove()) != NULL)
+	packet->Release();		// lost with the machine
+    delete inFlight;
+    for (int i = 0; i < MaxMachines; i++)
+	delete links[i];
+    if (inPacket != NULL)
+	inPacket->Release();
+    interrupt->UnwatchInput(sock);
     CloseSocket(sock);
     DeAssignNameToSocket(sockName);
 }
 
+// model the wire to machine "to" with its own reliability, bandwidth
+// and latency, instead of those given to the constructor
+void
+Network::SetLink(NetworkAddress to, double reliability, int linkBandwidth,
+		 int linkLatency)
+{
+    ASSERT(to >= 0 && to < MaxMachines && to != ident);
+    ASSERT(linkBandwidth > 0 && linkLatency >= 0);
+    if (links[to] == NULL) {
+	links[to] = new LinkModel;
+	links[to]->linkFree = 0;
+    }
+    if (reliability < 0) reliability = 0;
+    else if (reliability > 1) reliability = 1;
+    links[to]->chanceToWork = reliability;
+    links[to]->bandwidth = linkBandwidth;
+    links[to]->latency = linkLatency;
+}
+
+// the wire to machine "to"
+LinkModel *
+Network::Link(NetworkAddress to)
+{
+    if (to >= 0 && to < MaxMachines && links[to] != NULL)
+	return links[to];
+    return &defaultLink;
+}
+
+// Called NetworkTime after a packet arrived on the socket.
 // if a packet is already buffered, we simply delay reading 
-// the incoming packet.  In real life, the incoming 
-// packet might be dropped if we can't read it in time.
+// the incoming packet, until Receive empties the buffer.  In real
+// life, the incoming packet might be dropped if we can't read it in time.
 void
 Network::CheckPktAvail()
 {
-    // schedule the next time to poll for a packet
-    interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
-
-    if (inHdr.length != 0) 	// do nothing if packet is already buffered
+    if (inPacket != NULL) 	// Receive will arm the socket again
 	return;		
-    if (!PollSocket(sock)) 	// do nothing if no packet to be read
+    if (!PollSocket(sock)) {	// wait for a packet to be read
+	interrupt->ArmInput(sock);
 	return;
+    }
 
-    // otherwise, read packet in
-    char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
-
-    // divide packet into header and data
-    inHdr = *(PacketHeader *)buffer;
-    ASSERT((inHdr.to == ident) && (inHdr.length <= MaxPacketSize));
-    bcopy(buffer + sizeof(PacketHeader), inbox, inHdr.length);
-    delete []buffer ;
+    // otherwise, read packet in, header and data as they are on the wire
+    inPacket = PacketBuffer::Get();
+    ReadFromSocket(sock, inPacket->data, MaxWireSize);
+    ASSERT((inPacket->Header()->to == ident)
+	   && (inPacket->Header()->length <= MaxPacketSize));
 
     DEBUG('n', "Network received packet from %d, length %d...\n",
-	  				(int) inHdr.from, inHdr.length);
+	  (int) inPacket->Header()->from, inPacket->Header()->length);
     stats->numPacketsRecvd++;
 
     // tell post office that the packet has arrived
     (*readHandler)(handlerArg);	
 }
 
-// notify user that another packet can be sent
+// a packet is on the wire, notify user that another one can be queued
 void
 Network::SendDone()
 {
-    sendBusy = FALSE;
+    numQueued--;
     stats->numPacketsSent++;
     (*writeHandler)(handlerArg);
 }
 
-// send a packet by concatenating hdr and data, and schedule
-// an interrupt to tell the user when the next packet can be sent 
+// the packets whose arrival time has come reach the other machines:
+// put them all into the socket at once
+void
+Network::Arrive()
+{
+    List arrived;
+    PacketBuffer *packet;
+    long long when;
+    int numArrived = 0, numLost;
+
+    while ((packet = (PacketBuffer *) inFlight->SortedRemove(&when)) != NULL) {
+	if (when > stats->totalTicks) {	// not yet, keep it first
+	    inFlight->SortedInsert(packet, when);
+	    break;
+	}
+	arrived.Append(packet);
+	numArrived++;
+    }
+    if (numArrived == 0)
+	return;
+
+    PacketBuffer **packets = new PacketBuffer *[numArrived];
+    const char **buffers = new const char *[numArrived];
+    const char **toNames = new const char *[numArrived];
+    char (*names)[32] = new char[numArrived][32];
+
+    for (int i = 0; i < numArrived; i++) {
+	packets[i] = (PacketBuffer *) arrived.Remove();
+	buffers[i] = packets[i]->data;
+	sprintf(names[i], "SOCKET_%d", (int)packets[i]->Header()->to);
+	toNames[i] = names[i];
+    }
+    numLost = SendToSocketBatch(sock, buffers, numArrived, MaxWireSize,
+				toNames);
+    if (numLost > 0) {		// nobody there, lost on the wire
+	DEBUG('n', "%d packets lost, no machine to receive them\n", numLost);
+	stats->numPacketsUndelivered += numLost;
+    }
+    for (int i = 0; i < numArrived; i++)
+	packets[i]->Release();
+    delete [] packets;
+    delete [] buffers;
+    delete [] toNames;
+    delete [] names;
+}
+
+// queue a packet, copying hdr and data into a buffer
+void
+Network::Send(PacketHeader hdr, char* data)
+{
+    PacketBuffer *packet = PacketBuffer::Get();
+
+    ASSERT(hdr.length <= MaxPacketSize);
+    *packet->Header() = hdr;
+    bcopy(data, packet->Payload(), hdr.length);
+    SendBuffer(packet);
+}
+
+// queue the packet in a buffer.  The wire to the other machine takes
+// the packets one after the other, each taking its size divided by the
+// bandwidth: schedule an interrupt to tell the user when this one is
+// on it, and another one when it reaches the other machine.  Arrive
+// handles all the packets arriving at the same tick with one system
+// call.
 //
 // Note we always pad out a packet to MaxWireSize before putting it into
 // the socket, because it's simpler at the receive end.
 void
-Network::Send(PacketHeader hdr, char* data)
+Network::SendBuffer(PacketBuffer *packet)
 {
-    char toName[32];
+    PacketHeader hdr = *packet->Header();
+    LinkModel *link = Link(hdr.to);
+    long long start, arrival;
+    int wireTime;
 
-    sprintf(toName, "SOCKET_%d", (int)hdr.to);
-    
-    ASSERT((sendBusy == FALSE) && (hdr.length > 0) 
+    ASSERT((numQueued < depth) && (hdr.length > 0) 
 		&& (hdr.length <= MaxPacketSize) && (hdr.from == ident));
     DEBUG('n', "Sending to addr %d, %d bytes... ", hdr.to, hdr.length);
 
-    interrupt->Schedule(NetworkSendDone, (int)this, NetworkTime, NetworkSendInt);
+    start = link->linkFree > stats->totalTicks ? link->linkFree
+					       : stats->totalTicks;
+    wireTime = (sizeof(PacketHeader) + hdr.length) * 1000 / link->bandwidth;
+    if (wireTime < 1)
+	wireTime = 1;
+    link->linkFree = start + wireTime;
+    numQueued++;
+    interrupt->Schedule(NetworkSendDone, (int)this,
+			link->linkFree - stats->totalTicks, NetworkSendInt);
 
-    if (Random() % 100 >= chanceToWork * 100) { // emulate a lost packet
+    if (Random() % 100 >= link->chanceToWork * 100) { // emulate a lost packet
 	DEBUG('n', "oops, lost it!\n");
+	packet->Release();
 	return;
     }
+    arrival = link->linkFree + link->latency;
+    DEBUG('n', "arriving at %lld\n", arrival);
 
-    // concatenate hdr and data into a single buffer, and send it out
-    char *buffer = new char[MaxWireSize];
-    *(PacketHeader *)buffer = hdr;
-    bcopy(data, buffer + sizeof(PacketHeader), hdr.length);
-    SendToSocket(sock, buffer, MaxWireSize, toName);
-    delete []buffer;
+    // keep the buffer until the packet arrives
+    inFlight->SortedInsert(packet, arrival);
+    interrupt->Schedule(NetworkArrive, (int)this,
+			arrival - stats->totalTicks, NetworkSendInt);
 }
 
 // read a packet, if one is buffered
 PacketHeader
 Network::Receive(char* data)
 {
-    PacketHeader hdr = inHdr;
+    PacketBuffer *packet = ReceiveBuffer();
+    PacketHeader hdr;
 
-    inHdr.length = 0;
-    if (hdr.length != 0)
-    	bcopy(inbox, data, hdr.length);
+    if (packet == NULL) {
+	hdr.length = 0;
+	return hdr;
+    }
+    hdr = *packet->Header();
+    bcopy(packet->Payload(), data, hdr.length);
+    packet->Release();
     return hdr;
 }
+
+// hand the buffer of the packet over, if one is buffered
+PacketBuffer *
+Network::ReceiveBuffer()
+{
+    PacketBuffer *packet = inPacket;
+
+    inPacket = NULL;
+    if (packet != NULL)
+	interrupt->ArmInput(sock);	// room for the next packet
+    return packet;
+}
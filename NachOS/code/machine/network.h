@@ -17,11 +17,14 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "list.h"
 
 // Network address -- uniquely identifies a machine.  This machine's ID 
-//  is given on the command line.
+//  is given on the command line, from 0 to MaxMachines - 1.
 typedef int NetworkAddress;	 
 
+#define MaxMachines	64
+
 // The following class defines the network packet header.
 // The packet header is prepended to the data payload by the Network driver, 
 // before the packet is sent over the wire.  The format on the wire is:  
@@ -37,10 +40,67 @@ class PacketHeader {
 				// MailHeader prepended by the post office)
 };
 
-#define MaxWireSize 	64	// largest packet that can go out on the wire
+// The largest packet that can go out on the wire (the MTU) is chosen
+// when Nachos starts (-mtu flag), it must be the same on all machines
+// and not change once the Network has been created.
+
+#define DefaultWireSize	64
+extern int wireSize;
+
+#define MaxWireSize 	wireSize	// largest packet that can go out
+					// on the wire
 #define MaxPacketSize 	(MaxWireSize - sizeof(struct PacketHeader))	
 				// data "payload" of the largest packet
 
+// The following class defines a buffer holding one packet, as it is on
+// the wire: the PacketHeader, then the data.  Packets are handed from
+// the network to the post office and its mailboxes, and back, as
+// buffers rather than copied: a buffer is freed when the last one using
+// it drops its reference.  Freed buffers are kept for the next packets.
+
+class PacketBuffer {
+  public:
+    static PacketBuffer *Get();	// a buffer of MaxWireSize bytes, with
+				// one reference
+    void AddRef() { refCount++; }
+    void Release();		// drop one reference
+
+    PacketHeader *Header() { return (PacketHeader *) data; }
+    char *Payload() { return data + sizeof(PacketHeader); }
+    char *data;			// MaxWireSize bytes
+
+  private:
+    PacketBuffer();
+    int refCount;
+    PacketBuffer *next;		// in the pool of free buffers
+    static PacketBuffer *pool;
+};
+
+// The link is modelled by three numbers.  "Depth" is the number of
+// packets the device holds before they are put on the wire: Send can
+// be called again as long as fewer are waiting.  "Bandwidth", in bytes
+// per 1000 ticks, is how fast they are put on the wire one after the
+// other, and "latency", in ticks, how long they then take to reach the
+// other machine.  The defaults put a packet on the wire in NetworkTime,
+// one at a time, as the original device did.
+#define DefaultNetworkDepth	1
+#define DefaultNetworkBandwidth	(DefaultWireSize * 1000 / NetworkTime)
+#define DefaultNetworkLatency	0
+
+// The machines are connected by a switch: each one has its own wire to
+// each of the others, with its own reliability, bandwidth and latency.
+// They are those given to the constructor, unless SetLink chose others
+// for the wire to a given machine (-link flag, see also cluster.h).
+
+class LinkModel {
+  public:
+    double chanceToWork;	// Likelihood a packet gets through
+    int bandwidth;		// Bytes put on the wire per 1000 ticks
+    int latency;		// Ticks for a packet to cross the wire
+    long long linkFree;		// When the packets queued for this wire
+				//   will all be on it
+};
+
 
 // The following class defines a physical network device.  The network
 // is capable of delivering fixed sized packets, in order but unreliably, 
@@ -55,19 +115,33 @@ class PacketHeader {
 class Network {
   public:
     Network(NetworkAddress addr, double reliability,
-  	  VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, int callArg);
+  	  VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, int callArg,
+	  int queueDepth, int linkBandwidth, int linkLatency);
 				// Allocate and initialize network driver
     ~Network();			// De-allocate the network driver data
     
     void Send(PacketHeader hdr, char* data);
     				// Send the packet data to a remote machine,
 				// specified by "hdr".  Returns immediately.
-    				// "writeHandler" is invoked once the next 
-				// packet can be sent.  Note that writeHandler 
+				// Fewer than QueueDepth() packets may be
+				// waiting for the wire.
+    				// "writeHandler" is invoked once for each 
+				// packet put on the wire, freeing its place 
+				// in the queue.  Note that writeHandler 
 				// is called whether or not the packet is 
 				// dropped, and note that the "from" field of 
 				// the PacketHeader is filled in automatically 
 				// by Send().
+    int QueueDepth() { return depth; }
+    void SetLink(NetworkAddress to, double reliability, int linkBandwidth,
+		 int linkLatency);
+				// Model the wire to machine "to" apart
+    int Latency(NetworkAddress to) { return Link(to)->latency; }
+
+    void SendBuffer(PacketBuffer *packet);
+				// Same, the header and data being already 
+				// in "packet": the network takes over the 
+				// reference of the caller
 
     PacketHeader Receive(char* data);
     				// Poll the network for incoming messages.  
@@ -75,14 +149,19 @@ class Network {
 				// packet into "data" and return the header.
 				// If no packet is waiting, return a header 
 				// with length 0.
+    PacketBuffer *ReceiveBuffer();
+				// Same, returning the buffer the packet was 
+				// read in, NULL if there is none: the 
+				// caller gets the network's reference
 
     void SendDone();		// Interrupt handler, called when message is 
 				// sent
+    void Arrive();		// Interrupt handler, called when messages 
+				// reach the other machine
     void CheckPktAvail();	// Check if there is an incoming packet
 
   private:
     NetworkAddress ident;	// This machine's network address
-    double chanceToWork;	// Likelihood packet will be dropped
     int sock;			// UNIX socket number for incoming packets
     char sockName[32];		// File name corresponding to UNIX socket
     VoidFunctionPtr writeHandler; // Interrupt handler, signalling next packet 
@@ -91,11 +170,15 @@ class Network {
 				// 	arrived.
     int handlerArg;		// Argument to be passed to interrupt handler
 				//   (pointer to post office)
-    bool sendBusy;		// Packet is being sent.
+    int depth;			// Packets the device can hold
+    int numQueued;		// Packets not on the wire yet
+    LinkModel defaultLink;	// The wires SetLink did not change
+    LinkModel *links[MaxMachines];	// The others, NULL for the default
+    LinkModel *Link(NetworkAddress to);
+    List *inFlight;		// Packets not arrived yet, by arrival time
     bool packetAvail;		// Packet has arrived, can be pulled off of
 				//   network
-    PacketHeader inHdr;		// Information about arrived packet
-    char inbox[MaxPacketSize];  // Data for arrived packet
+    PacketBuffer *inPacket;	// Arrived packet, NULL if none
 };
 
 #endif // NETWORK_H
@@ -22,6 +22,13 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numRetransmits = numPacketsUndelivered = 0;
+    numTLBHits = numTLBMisses = 0;
+    numEvictions = numPageOuts = numDirtyWriteBacks = numPageIns = 0;
+    numMappedWriteBacks = 0;
+    numSuspensions = 0;
+    fragmentation = maxFragmentation = 0;
+    numCompactions = numMigrations = 0;
 }
 
 //----------------------------------------------------------------------
@@ -44,6 +51,27 @@ Statistics::Print()
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
     printf("Paging: faults %d\n", numPageFaults);
+    if (numEvictions + numPageIns > 0)
+	printf("Swap: evictions %d, page outs %d (%d dirty), page ins %d\n",
+	       numEvictions, numPageOuts, numDirtyWriteBacks, numPageIns);
+    if (numMappedWriteBacks > 0)
+	printf("Mmap: %d pages written back to their files\n",
+	       numMappedWriteBacks);
+    if (numSuspensions > 0)
+	printf("Admission: %d processes suspended while thrashing\n",
+	       numSuspensions);
+    if (numCompactions > 0)
+	printf("Compaction: %d runs freed, %d pages moved, fragmentation "
+	       "%d%% (peak %d%%)\n", numCompactions, numMigrations,
+	       fragmentation, maxFragmentation);
+    if (numTLBHits + numTLBMisses > 0)
+	printf("TLB: hits %d, misses %d, hit ratio %.2f%%\n", numTLBHits,
+	       numTLBMisses, 100.0 * numTLBHits / (numTLBHits + numTLBMisses));
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
+    if (numPacketsUndelivered > 0)
+	printf("Network: %d packets lost, no machine to receive them\n",
+	       numPacketsUndelivered);
+    if (numRetransmits > 0)
+	printf("Transport: %d segments sent again\n", numRetransmits);
 }
@@ -43,8 +43,28 @@ class Statistics {
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numEvictions;		// number of pages taken back from their
+				// frame to give it to another page
+    int numPageOuts;		// number of pages written to the swap space
+    int numDirtyWriteBacks;	// the ones that were modified since loaded
+    int numMappedWriteBacks;	// number of mapped pages written back to
+				// their file
+    int numPageIns;		// number of pages read back from it
+    int numSuspensions;		// number of processes suspended because
+				// the machine was thrashing
+    int fragmentation;		// percentage of the free frames outside
+				// any free aligned run of HugePageFactor
+    int maxFragmentation;	// highest value it reached
+    int numCompactions;		// number of runs of frames freed by
+				// moving pages out of them
+    int numMigrations;		// number of pages moved to do so
+    int numTLBHits;		// number of translations found in the TLB
+    int numTLBMisses;		// number of translations missing from it
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numRetransmits;		// number of stream segments sent again
+    int numPacketsUndelivered;	// number of packets whose destination
+				// machine was not there
 
     Statistics(); 		// initialize everything to zero
 
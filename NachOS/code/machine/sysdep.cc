@@ -37,10 +37,12 @@ extern "C" {
 #include <sys/mman.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <errno.h> // modif norme ansi
+#include <poll.h>
 
 // UNIX routines called by procedures in this file 
 
@@ -114,29 +116,55 @@ int sendto (int, const void*, int, int, void*, int);
 bool
 PollFile(int fd)
 {
-    int rfd = (1 << fd), wfd = 0, xfd = 0, retVal;
-    struct timeval pollTime;
+    struct pollfd pfd;
+    int retVal, pollTime;
 
 // decide how long to wait if there are no characters on the file
-    pollTime.tv_sec = 0;
     if (interrupt->getStatus() == IdleMode)
-        pollTime.tv_usec = 20000;              	// delay to let other nachos run
+        pollTime = 20;              		// delay to let other nachos run
     else
-        pollTime.tv_usec = 0;                 	// no delay
+        pollTime = 0;                 		// no delay
 
-// poll file or socket
-#if defined(HOST_i386) || defined(SOLARIS)
-    retVal = select(32, (fd_set*)&rfd, (fd_set*)&wfd, (fd_set*)&xfd, &pollTime);
-#else
-    retVal = select(32, &rfd, &wfd, &xfd, &pollTime);
-#endif
+// poll file or socket, whatever its number
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    retVal = poll(&pfd, 1, pollTime);
 
-    ASSERT((retVal == 0) || (retVal == 1));
-    if (retVal == 0)
+    ASSERT((retVal == 0) || (retVal == 1) || (errno == EINTR));
+    if (retVal <= 0)
 	return FALSE;                 		// no char waiting to be read
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// WaitForFiles
+// 	Wait for characters to arrive on any of "fds", for at most
+//	"timeout" milliseconds (forever if -1).  A signal ends the wait
+//	early, with nothing ready.
+//----------------------------------------------------------------------
+
+int
+WaitForFiles(const int *fds, int numFds, bool *ready, int timeout)
+{
+    struct pollfd *pfds = new struct pollfd[numFds];
+    int i, retVal;
+
+    for (i = 0; i < numFds; i++) {
+	pfds[i].fd = fds[i];
+	pfds[i].events = POLLIN;
+	pfds[i].revents = 0;
+    }
+    retVal = poll(pfds, numFds, timeout);
+    ASSERT((retVal >= 0) || (errno == EINTR));
+    if (retVal < 0)
+	retVal = 0;
+    for (i = 0; i < numFds; i++)
+	ready[i] = (retVal > 0) && (pfds[i].revents != 0);
+    delete [] pfds;
+    return retVal;
+}
+
 //----------------------------------------------------------------------
 // OpenForWrite
 // 	Open a file for writing.  Create it if it doesn't exist; truncate it 
@@ -208,6 +236,47 @@ WriteFile(int fd, const char *buffer, int nBytes)
     ASSERT(retVal == nBytes);
 }
 
+//----------------------------------------------------------------------
+// ReadFileAt, ReadPartialAt, WriteFileAt
+// 	Same as Read, ReadPartial and WriteFile, at "offset" in the file
+//	rather than at the current location, which does not change: one
+//	host system call instead of an Lseek and a transfer.
+//----------------------------------------------------------------------
+
+void
+ReadFileAt(int fd, char *buffer, int nBytes, int offset)
+{
+    int retVal = pread(fd, buffer, nBytes, offset);
+    ASSERT(retVal == nBytes);
+}
+
+int
+ReadPartialAt(int fd, char *buffer, int nBytes, int offset)
+{
+    return pread(fd, buffer, nBytes, offset);
+}
+
+void
+WriteFileAt(int fd, const char *buffer, int nBytes, int offset)
+{
+    int retVal = pwrite(fd, buffer, nBytes, offset);
+    ASSERT(retVal == nBytes);
+}
+
+//----------------------------------------------------------------------
+// FileLength
+// 	Return the size in bytes of an open file.
+//----------------------------------------------------------------------
+
+int
+FileLength(int fd)
+{
+    struct stat buf;
+    int retVal = fstat(fd, &buf);
+    ASSERT(retVal >= 0);
+    return (int) buf.st_size;
+}
+
 //----------------------------------------------------------------------
 // Lseek
 // 	Change the location within an open file.  Abort on error.
@@ -236,6 +305,21 @@ Tell(int fd)
 }
 
 
+//----------------------------------------------------------------------
+// FileId
+// 	Return a number identifying the file open on "fd" (its inode
+//	number), the same for every descriptor open on that file.
+//----------------------------------------------------------------------
+
+int
+FileId(int fd)
+{
+    struct stat buf;
+    int retVal = fstat(fd, &buf);
+    ASSERT(retVal >= 0);
+    return (int) buf.st_ino;
+}
+
 //----------------------------------------------------------------------
 // Close
 // 	Close a file.  Abort on error.
@@ -377,9 +461,11 @@ ReadFromSocket(int sockID, char *buffer, int packetSize)
 //----------------------------------------------------------------------
 // SendToSocket
 // 	Transmit a fixed size packet to another Nachos' IPC port.
-//	Abort on error.
+//	Return FALSE if it cannot be sent, typically because that Nachos
+//	has not started yet or has already halted: to the caller, the
+//	packet is lost on the wire.
 //----------------------------------------------------------------------
-void
+bool
 SendToSocket(int sockID, const char *buffer, int packetSize, const char *toName)
 {
     struct sockaddr_un uName;
@@ -388,9 +474,58 @@ SendToSocket(int sockID, const char *buffer, int packetSize, const char *toName)
     InitSocketName(&uName, toName);
     retVal = sendto(sockID, buffer, packetSize, 0,
 			  (sockaddr *) &uName, sizeof(uName));
-    ASSERT(retVal == packetSize);
+    return retVal == packetSize;
 }
 
+//----------------------------------------------------------------------
+// SendToSocketBatch
+// 	Transmit "numPackets" fixed size packets, the i-th one from
+//	"buffers[i]" to the IPC port "toNames[i]".
+//	On Linux they are all given to sendmmsg at once, elsewhere sent
+//	one by one.  A packet that cannot be sent is skipped, see
+//	SendToSocket.  Return the number of them.
+//----------------------------------------------------------------------
+int
+SendToSocketBatch(int sockID, const char **buffers, int numPackets,
+		  int packetSize, const char **toNames)
+{
+#ifdef LINUX
+    struct sockaddr_un *uNames = new struct sockaddr_un[numPackets];
+    struct iovec *iov = new struct iovec[numPackets];
+    struct mmsghdr *msgs = new struct mmsghdr[numPackets];
+    int i, sent, retVal, numFailed = 0;
+
+    memset(msgs, 0, numPackets * sizeof(struct mmsghdr));
+    for (i = 0; i < numPackets; i++) {
+	InitSocketName(&uNames[i], toNames[i]);
+	iov[i].iov_base = (void *) buffers[i];
+	iov[i].iov_len = packetSize;
+	msgs[i].msg_hdr.msg_name = &uNames[i];
+	msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_un);
+	msgs[i].msg_hdr.msg_iov = &iov[i];
+	msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (sent = 0; sent < numPackets; sent += retVal) {
+	// stops at the first packet it cannot send: skip that one
+	retVal = sendmmsg(sockID, msgs + sent, numPackets - sent, 0);
+	if (retVal <= 0) {
+	    numFailed++;
+	    retVal = 1;
+	}
+    }
+    delete [] uNames;
+    delete [] iov;
+    delete [] msgs;
+    return numFailed;
+#else
+    int numFailed = 0;
+
+    for (int i = 0; i < numPackets; i++)
+	if (!SendToSocket(sockID, buffers[i], packetSize, toNames[i]))
+	    numFailed++;
+    return numFailed;
+#endif
+}
 
 //----------------------------------------------------------------------
 // CallOnUserAbort
@@ -404,6 +539,46 @@ CallOnUserAbort(VoidNoArgFunctionPtr func)
     (void)signal(SIGINT, (VoidFunctionPtr) func);
 }
 
+//----------------------------------------------------------------------
+// CallOnInput
+// 	Arrange that "func" will be called when input arrives on a file
+//	that NotifyOnInput was turned on for.  The system calls it
+//	interrupts are restarted.
+//----------------------------------------------------------------------
+
+void 
+CallOnInput(VoidNoArgFunctionPtr func)
+{
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = (VoidFunctionPtr) func;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    (void) sigaction(SIGIO, &action, NULL);
+}
+
+//----------------------------------------------------------------------
+// NotifyOnInput
+// 	Turn the input signal of "fd" on or off.  Errors are ignored: the
+//	files that cannot signal are only checked when asked to.
+//----------------------------------------------------------------------
+
+void 
+NotifyOnInput(int fd, bool on)
+{
+    int flags = fcntl(fd, F_GETFL);
+
+    if (flags < 0)
+	return;
+    if (on) {
+	(void) fcntl(fd, F_SETOWN, getpid());
+	flags |= O_ASYNC;
+    } else
+	flags &= ~O_ASYNC;
+    (void) fcntl(fd, F_SETFL, flags);
+}
+
 //----------------------------------------------------------------------
 // Sleep
 // 	Put the UNIX process running Nachos to sleep for x seconds,
@@ -439,6 +614,51 @@ Exit(int exitCode)
     exit(exitCode);
 }
 
+//----------------------------------------------------------------------
+// SpawnProcess
+// 	Run the program "path" in a new UNIX process, with the arguments
+//	"argv" (NULL terminated, argv[0] included).  Return the process
+//	id, or -1 if it cannot be created.
+//----------------------------------------------------------------------
+
+int
+SpawnProcess(const char *path, char **argv)
+{
+    int pid = fork();
+
+    if (pid == 0) {
+	execv(path, argv);
+	perror(path);
+	_exit(127);
+    }
+    return pid;
+}
+
+//----------------------------------------------------------------------
+// WaitForProcess
+// 	Wait for one of the processes started by SpawnProcess to end.
+//	Return its process id and store its exit code in "exitCode" (128
+//	plus the signal number if it was killed), or return -1 if none
+//	is left.
+//----------------------------------------------------------------------
+
+int
+WaitForProcess(int *exitCode)
+{
+    int status, pid;
+
+    do {
+	pid = waitpid(-1, &status, 0);
+    } while (pid < 0 && errno == EINTR);
+    if (pid < 0)
+	return -1;
+    if (WIFEXITED(status))
+	*exitCode = WEXITSTATUS(status);
+    else
+	*exitCode = 128 + WTERMSIG(status);
+    return pid;
+}
+
 //----------------------------------------------------------------------
 // RandomInit
 // 	Initialize the pseudo-random number generator.  We use the
@@ -14,9 +14,21 @@
 #include "copyright.h"
 
 // Check file to see if there are any characters to be read.
-// If no characters in the file, return without waiting.
+// If no characters in the file, return without waiting (but for a
+// short delay when Nachos is idle).
 extern bool PollFile(int fd);
 
+// Wait up to "timeout" milliseconds (-1: forever, 0: not at all) for
+// characters to read on any of the "numFds" files "fds".  Set
+// "ready[i]" for the ones that have some, and return their number.
+extern int WaitForFiles(const int *fds, int numFds, bool *ready, int timeout);
+
+// Have "func" called (from a signal handler) whenever input arrives
+// on one of the files NotifyOnInput was turned on for.  Regular files
+// never signal, they are always ready.
+extern void CallOnInput(VoidNoArgFunctionPtr func);
+extern void NotifyOnInput(int fd, bool on);
+
 // File operations: open/read/write/lseek/close, and check for error
 // For simulating the disk and the console devices.
 extern int OpenForWrite(const char *name);
@@ -25,9 +37,15 @@ extern void Read(int fd, char *buffer, int nBytes);
 extern int ReadPartial(int fd, char *buffer, int nBytes);
 extern void WriteFile(int fd, const char *buffer, int nBytes);
 extern void Lseek(int fd, int offset, int whence);
+// Positional versions, leaving the current location alone
+extern void ReadFileAt(int fd, char *buffer, int nBytes, int offset);
+extern int ReadPartialAt(int fd, char *buffer, int nBytes, int offset);
+extern void WriteFileAt(int fd, const char *buffer, int nBytes, int offset);
+extern int FileLength(int fd);
 extern int Tell(int fd);
 extern void Close(int fd);
 extern bool Unlink(const char *name);
+extern int FileId(int fd);
 
 // Interprocess communication operations, for simulating the network
 extern int OpenSocket();
@@ -36,13 +54,24 @@ extern void AssignNameToSocket(const char *socketName, int sockID);
 extern void DeAssignNameToSocket(const char *socketName);
 extern bool PollSocket(int sockID);
 extern void ReadFromSocket(int sockID, char *buffer, int packetSize);
-extern void SendToSocket(int sockID, const char *buffer, int packetSize, const char *toName);
+// FALSE if the packet could not be sent (no such socket)
+extern bool SendToSocket(int sockID, const char *buffer, int packetSize, const char *toName);
+// Send "numPackets" packets of "packetSize" bytes, the i-th one from
+// "buffers[i]" to "toNames[i]", in as few system calls as the host
+// allows.  Return the number of packets that could not be sent.
+extern int SendToSocketBatch(int sockID, const char **buffers, int numPackets,
+			      int packetSize, const char **toNames);
 
 // Process control: abort, exit, and sleep
 extern void Abort();
 extern void Exit(int exitCode);
 extern void Delay(int seconds);
 
+// Start the program "path" in a new host process, wait for one of them
+// to end (see the network cluster launcher, cluster.h)
+extern int SpawnProcess(const char *path, char **argv);
+extern int WaitForProcess(int *exitCode);
+
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(VoidNoArgFunctionPtr cleanUp);
 
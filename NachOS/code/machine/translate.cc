@@ -71,6 +71,27 @@ unsigned short
 ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 
 
+//----------------------------------------------------------------------
+// Machine::RetryKernelAccess
+//      The kernel touches user memory on behalf of a system call (to
+//      copy a string, for instance), and the translation failed.  There
+//      is no user instruction to restart in that case, so let the kernel
+//      resolve the fault right now (copy-on-write, ...), and tell the
+//      caller whether to translate again.
+//----------------------------------------------------------------------
+
+bool
+Machine::RetryKernelAccess(ExceptionType which, int badVAddr)
+{
+    if (interrupt->getStatus() != SystemMode)
+	return FALSE;		// user instruction: it will be restarted
+    if (which != PageFaultException && which != ReadOnlyException)
+	return FALSE;
+    registers[BadVAddrReg] = badVAddr;
+    ExceptionHandler(which);
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Machine::ReadMem
 //      Read "size" (1, 2, or 4) bytes of virtual memory at "addr" into 
@@ -94,6 +115,8 @@ Machine::ReadMem(int addr, int size, int *value)
     DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
     
     exception = Translate(addr, &physicalAddress, size, FALSE);
+    if (exception != NoException && RetryKernelAccess(exception, addr))
+	exception = Translate(addr, &physicalAddress, size, FALSE);
     if (exception != NoException) {
 	machine->RaiseException(exception, addr);
 	return FALSE;
@@ -143,6 +166,8 @@ Machine::WriteMem(int addr, int size, int value)
     DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
 
     exception = Translate(addr, &physicalAddress, size, TRUE);
+    if (exception != NoException && RetryKernelAccess(exception, addr))
+	exception = Translate(addr, &physicalAddress, size, TRUE);
     if (exception != NoException) {
 	machine->RaiseException(exception, addr);
 	return FALSE;
@@ -168,6 +193,68 @@ Machine::WriteMem(int addr, int size, int value)
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::ReadBlock, Machine::WriteBlock
+//      Copy "size" bytes of virtual memory at "addr" to "buffer", or
+//	the other way around, on behalf of a system call.  Each page is
+//	translated once, and the part of it concerned copied at once,
+//	instead of going through ReadMem or WriteMem for each byte.
+//
+//   	Returns FALSE if some page could not be translated.
+//----------------------------------------------------------------------
+
+bool
+Machine::ReadBlock(int addr, char *buffer, int size)
+{
+    ExceptionType exception;
+    int physicalAddress, chunk;
+
+    DEBUG('a', "Reading block at VA 0x%x, size %d\n", addr, size);
+    while (size > 0) {
+	chunk = PageSize - addr % PageSize;
+	if (chunk > size)
+	    chunk = size;
+	exception = Translate(addr, &physicalAddress, 1, FALSE);
+	if (exception != NoException && RetryKernelAccess(exception, addr))
+	    exception = Translate(addr, &physicalAddress, 1, FALSE);
+	if (exception != NoException) {
+	    machine->RaiseException(exception, addr);
+	    return FALSE;
+	}
+	bcopy(&mainMemory[physicalAddress], buffer, chunk);
+	addr += chunk;
+	buffer += chunk;
+	size -= chunk;
+    }
+    return TRUE;
+}
+
+bool
+Machine::WriteBlock(int addr, const char *buffer, int size)
+{
+    ExceptionType exception;
+    int physicalAddress, chunk;
+
+    DEBUG('a', "Writing block at VA 0x%x, size %d\n", addr, size);
+    while (size > 0) {
+	chunk = PageSize - addr % PageSize;
+	if (chunk > size)
+	    chunk = size;
+	exception = Translate(addr, &physicalAddress, 1, TRUE);
+	if (exception != NoException && RetryKernelAccess(exception, addr))
+	    exception = Translate(addr, &physicalAddress, 1, TRUE);
+	if (exception != NoException) {
+	    machine->RaiseException(exception, addr);
+	    return FALSE;
+	}
+	bcopy(buffer, &mainMemory[physicalAddress], chunk);
+	addr += chunk;
+	buffer += chunk;
+	size -= chunk;
+    }
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using 
@@ -187,8 +274,8 @@ ExceptionType
 Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 {
     int i;
-    unsigned int vpn, offset;
-    TranslationEntry *entry;
+    unsigned int vpn, offset, hugeVpn;
+    TranslationEntry *entry, *hugeEntry;
     unsigned int pageFrame;
 
     DEBUG('a', "\tTranslate 0x%x, %s: ", virtAddr, writing ? "write" : "read");
@@ -200,39 +287,66 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     }
     
     // we must have either a TLB or a page table, but not both!
-    ASSERT(tlb == NULL || pageTable == NULL);	
-    ASSERT(tlb != NULL || pageTable != NULL);	
+    ASSERT(tlb == NULL || (pageTable == NULL && pageDirectory == NULL));	
+    ASSERT(tlb != NULL || pageTable != NULL || pageDirectory != NULL);	
 
 // calculate the virtual page number, and offset within the page,
 // from the virtual address
     vpn = (unsigned) virtAddr / PageSize;
     offset = (unsigned) virtAddr % PageSize;
+    hugeVpn = vpn - vpn % HugePageFactor;	// first page of its huge page
     
     if (tlb == NULL) {		// => page table => vpn is index into table
 	if (vpn >= pageTableSize) {
 	    DEBUG('a', "virtual page # %d too large for page table size %d!\n", 
 			virtAddr, pageTableSize);
 	    return AddressErrorException;
-	} else if (!pageTable[vpn].valid) {
+	}
+	if (pageDirectory == NULL) {
+	    entry = &pageTable[vpn];
+	    hugeEntry = &pageTable[hugeVpn];
+	} else if (pageDirectory[vpn / SecondLevelSize] == NULL)
+	    entry = hugeEntry = NULL;	// nothing mapped around vpn
+	else {
+	    entry = &pageDirectory[vpn / SecondLevelSize][vpn % SecondLevelSize];
+	    hugeEntry =
+		&pageDirectory[vpn / SecondLevelSize][hugeVpn % SecondLevelSize];
+	}
+	if (hugeEntry != NULL && hugeEntry->valid && hugeEntry->huge)
+	    entry = hugeEntry;
+	if (entry == NULL || !entry->valid) {
 	    DEBUG('a', "virtual page # %d is not valid!\n",
 			virtAddr, pageTableSize);
 	    return PageFaultException;
 	}
-	entry = &pageTable[vpn];
     } 
 
     else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
-    	    if (tlb[i].valid && (tlb[i].virtualPage == vpn)) {
+	int set = vpn % tlbNumSets;
+        for (entry = NULL, i = set * tlbNumWays; i < (set + 1) * tlbNumWays; i++)
+    	    if (tlb[i].valid && (tlb[i].virtualPage == vpn)
+		&& (tlb[i].asid == currentAsid)) {
 		entry = &tlb[i];			// FOUND!
 		break;
 	    }
+	if (entry == NULL) {		// a huge page is in the set of its first page
+	    set = hugeVpn % tlbNumSets;
+	    for (i = set * tlbNumWays; i < (set + 1) * tlbNumWays; i++)
+		if (tlb[i].valid && tlb[i].huge && (tlb[i].virtualPage == hugeVpn)
+		    && (tlb[i].asid == currentAsid)) {
+		    entry = &tlb[i];
+		    break;
+		}
+	}
 		if (entry == NULL) {				// not found
     	    DEBUG('a', "*** no valid TLB entry found for this virtual page!\n");
+	    stats->numTLBMisses++;
     	    return PageFaultException;		// really, this is a TLB fault,
 						// the page may be in memory,
 						// but not in the TLB
 		}
+	stats->numTLBHits++;
+	tlbLastUse[i] = ++tlbClock;
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
@@ -240,10 +354,12 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	return ReadOnlyException;
     }
     pageFrame = entry->physicalPage;
+    if (entry->huge)
+	pageFrame += vpn - entry->virtualPage;
 
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
-    if (pageFrame >= NumPhysPages) { 
+    if (pageFrame >= (unsigned) NumPhysPages) { 
 	DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
 	return BusErrorException;
     }
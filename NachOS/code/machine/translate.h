@@ -40,6 +40,14 @@ class TranslationEntry {
 			// page is referenced or modified.
     bool dirty;         // This bit is set by the hardware every time the
 			// page is modified.
+    unsigned int asid;	// In the TLB, the address space the entry belongs
+			// to: it only matches when Machine::currentAsid
+			// is the same.  Ignored in page tables.
+    bool huge;		// The entry maps HugePageFactor pages, from
+			// "virtualPage" (a multiple of HugePageFactor) to
+			// as many frames from "physicalPage".  In a page
+			// table, only the entry of the first page is used,
+			// the use and dirty bits are set there.
 };
 
 #endif
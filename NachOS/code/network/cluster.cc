@@ -0,0 +1,179 @@
+// cluster.cc
+//	Launch the machines of a cluster, each in its own host process,
+//	and wait for them.  See cluster.h for the description file.
+
+#include "copyright.h"
+#include "utility.h"
+#include "cluster.h"
+
+#define MaxClusterLine	1024
+
+class ClusterNode {
+  public:
+    int id;
+    char *args[MaxClusterArgs];	// its own flags
+    int numArgs;
+    int pid;			// host process, -1 once ended
+};
+
+class ClusterLink {
+  public:
+    int a, b;
+    char *model[3];		// reliability, bandwidth, latency
+};
+
+//----------------------------------------------------------------------
+// SplitLine
+//      Cut "line" into words, stopping at a '#'.  Return their number,
+//	-1 if there are more than "maxWords".
+//----------------------------------------------------------------------
+
+static int
+SplitLine(char *line, char **words, int maxWords)
+{
+    int numWords = 0;
+    char *comment = strchr(line, '#');
+
+    if (comment != NULL)
+	*comment = '\0';
+    for (char *word = strtok(line, " \t\r\n"); word != NULL;
+	 word = strtok(NULL, " \t\r\n")) {
+	if (numWords == maxWords)
+	    return -1;
+	words[numWords++] = word;
+    }
+    return numWords;
+}
+
+//----------------------------------------------------------------------
+// CopyWords
+//      Keep "numWords" words past the line they were read in.
+//----------------------------------------------------------------------
+
+static void
+CopyWords(char **to, char **words, int numWords)
+{
+    for (int i = 0; i < numWords; i++)
+	to[i] = strdup(words[i]);
+}
+
+//----------------------------------------------------------------------
+// RunCluster
+//      Read the description of the cluster, start a Nachos for each
+//	node with its flags: "-m" and its identity, a "-link" for each
+//	link it is on, the common flags and its own.  Then wait for them
+//	all, reporting those failing.
+//
+//	"nachos" -- the Nachos executable to run
+//	"configFile" -- the description of the cluster
+//----------------------------------------------------------------------
+
+int
+RunCluster(const char *nachos, const char *configFile)
+{
+    ClusterNode nodes[MaxClusterNodes];
+    ClusterLink links[MaxClusterNodes];
+    char *common[MaxClusterArgs];
+    int numNodes = 0, numLinks = 0, numCommon = 0;
+    char line[MaxClusterLine];
+    char *words[MaxClusterArgs];
+    int numWords, lineNum = 0, failed = 0;
+    FILE *config = fopen(configFile, "r");
+
+    if (config == NULL) {
+	printf("Cluster: cannot open %s\n", configFile);
+	return 1;
+    }
+    while (fgets(line, MaxClusterLine, config) != NULL) {
+	lineNum++;
+	numWords = SplitLine(line, words, MaxClusterArgs);
+	if (numWords == 0)
+	    continue;
+	if (numWords > 0 && !strcmp(words[0], "all")
+	    && numCommon + numWords - 1 <= MaxClusterArgs) {
+	    CopyWords(common + numCommon, words + 1, numWords - 1);
+	    numCommon += numWords - 1;
+	} else if (numWords >= 2 && !strcmp(words[0], "node")
+		   && numNodes < MaxClusterNodes) {
+	    nodes[numNodes].id = atoi(words[1]);
+	    nodes[numNodes].numArgs = numWords - 2;
+	    CopyWords(nodes[numNodes].args, words + 2, numWords - 2);
+	    numNodes++;
+	} else if (numWords == 6 && !strcmp(words[0], "link")
+		   && numLinks < MaxClusterNodes) {
+	    links[numLinks].a = atoi(words[1]);
+	    links[numLinks].b = atoi(words[2]);
+	    CopyWords(links[numLinks].model, words + 3, 3);
+	    numLinks++;
+	} else {
+	    printf("Cluster: %s, line %d not understood\n", configFile,
+		   lineNum);
+	    fclose(config);
+	    return 1;
+	}
+    }
+    fclose(config);
+
+    for (int i = 0; i < numNodes; i++) {
+	char *argv[3 + 5 * MaxClusterNodes + 2 * MaxClusterArgs + 1];
+	char ident[12], peers[MaxClusterNodes][12];
+	int argc = 0;
+
+	argv[argc++] = (char *) nachos;
+	argv[argc++] = (char *) "-m";
+	sprintf(ident, "%d", nodes[i].id);
+	argv[argc++] = ident;
+	for (int j = 0; j < numLinks; j++) {
+	    int peer;
+
+	    if (links[j].a == nodes[i].id)
+		peer = links[j].b;
+	    else if (links[j].b == nodes[i].id)
+		peer = links[j].a;
+	    else
+		continue;
+	    sprintf(peers[j], "%d", peer);
+	    argv[argc++] = (char *) "-link";
+	    argv[argc++] = peers[j];
+	    for (int k = 0; k < 3; k++)
+		argv[argc++] = links[j].model[k];
+	}
+	for (int j = 0; j < numCommon; j++)
+	    argv[argc++] = common[j];
+	for (int j = 0; j < nodes[i].numArgs; j++)
+	    argv[argc++] = nodes[i].args[j];
+	argv[argc] = NULL;
+
+	nodes[i].pid = SpawnProcess(nachos, argv);
+	if (nodes[i].pid < 0) {
+	    printf("Cluster: cannot start machine %d\n", nodes[i].id);
+	    failed = 1;
+	}
+    }
+
+    for (;;) {
+	int exitCode, pid = WaitForProcess(&exitCode);
+
+	if (pid < 0)
+	    break;
+	for (int i = 0; i < numNodes; i++)
+	    if (nodes[i].pid == pid) {
+		nodes[i].pid = -1;
+		if (exitCode != 0) {
+		    printf("Cluster: machine %d exited with %d\n",
+			   nodes[i].id, exitCode);
+		    failed = 1;
+		}
+	    }
+    }
+
+    for (int j = 0; j < numCommon; j++)
+	free(common[j]);
+    for (int i = 0; i < numNodes; i++)
+	for (int j = 0; j < nodes[i].numArgs; j++)
+	    free(nodes[i].args[j]);
+    for (int i = 0; i < numLinks; i++)
+	for (int k = 0; k < 3; k++)
+	    free(links[i].model[k]);
+    return failed;
+}
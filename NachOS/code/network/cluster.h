@@ -0,0 +1,44 @@
+// cluster.h
+//	Launch a cluster of Nachos machines described in one file,
+//	instead of starting each of them by hand with its -m flag.
+//
+//	Each machine is a Nachos of its own, in its own host process
+//	(the kernel is made of global objects, there can only be one per
+//	process), running the same executable as the launcher.  They are
+//	connected as usual by the sockets of their network devices; the
+//	wire between two machines is modelled by the sending one, in
+//	simulated ticks (see SetLink in network.h).
+//
+//	The file has one directive per line, '#' starts a comment:
+//
+//	  all <flags>		flags given to every machine
+//	  node <id> <flags>	a machine, with its own flags after the
+//				common ones
+//	  link <id> <id> <reliability> <bandwidth> <latency>
+//				the wire between two machines, both ways;
+//				the others are set by -l, -nbw and -nlat
+//
+//	For instance, the reliable stream test over a lossy, slow wire:
+//
+//	  all -l 0.9
+//	  node 0 -ot 1
+//	  node 1 -ot 0
+//	  link 0 1 0.8 500 200
+//
+//	The machines share the terminal of the launcher.
+
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include "copyright.h"
+
+#define MaxClusterNodes	64	// the machines that can have their own
+				// links, see MaxMachines
+#define MaxClusterArgs	64	// flags of a directive
+
+// Start the machines described in "configFile", running "nachos", and
+// wait for them all to end.  Return 0 if they all succeeded, 1
+// otherwise.
+extern int RunCluster(const char *nachos, const char *configFile);
+
+#endif // CLUSTER_H
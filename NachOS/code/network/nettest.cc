@@ -2,16 +2,10 @@
 //	Test out message delivery between two "Nachos" machines,
 //	using the Post Office to coordinate delivery.
 //
-//	Two caveats:
-//	  1. Two copies of Nachos must be running, with machine ID's 0 and 1:
+//	Two copies of Nachos must be running, with machine ID's 0 and 1:
 //		./nachos -m 0 -o 1 &
 //		./nachos -m 1 -o 0 &
 //
-//	  2. You need an implementation of condition variables,
-//	     which is *not* provided as part of the baseline threads 
-//	     implementation.  The Post Office won't work without
-//	     a correct implementation of condition variables.
-//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -22,6 +16,7 @@
 #include "network.h"
 #include "post.h"
 #include "interrupt.h"
+#include "transport.h"
 
 // Test out message delivery, by doing the following:
 //	1. send a message to the machine with ID "farAddr", at mail box #0
@@ -37,7 +32,7 @@ MailTest(int farAddr)
     MailHeader outMailHdr, inMailHdr;
     const char *data = "Hello there!";
     const char *ack = "Got it!";
-    char buffer[MaxMailSize];
+    char *buffer = new char[MaxMailSize];
 
     // construct packet, mail header for original message
     // To: destination machine, mailbox 0
@@ -68,5 +63,58 @@ MailTest(int farAddr)
     fflush(stdout);
 
     // Then we're done!
+    delete [] buffer;
+    interrupt->Halt();
+}
+
+// Test out the reliable stream of transport.h, by doing the following:
+//	1. open a connection between our mailbox #2 and the one of the
+//	   machine with ID "farAddr"
+//	2. the machine with the lowest ID sends StreamTestSize bytes, the
+//	   other one reads them and sends them back
+//	3. check that the bytes came back unchanged and in order
+//
+// Run with a reliability below 1 (-l) to see segments sent again.
+
+#define StreamTestSize 4096
+
+void
+StreamTest(int farAddr)
+{
+    Connection *conn = new Connection(postOffice, 2, farAddr, 2);
+    char *sent = new char[StreamTestSize];
+    char *received = new char[StreamTestSize];
+    int i;
+
+    for (i = 0; i < StreamTestSize; i++)
+	sent[i] = (char) (i * 7 + i / 256);
+
+    if (postOffice->GetAddress() < farAddr) {
+	if (!conn->Send(sent, StreamTestSize)
+	    || !conn->Receive(received, StreamTestSize))
+	    printf("Connection to %d failed\n", farAddr);
+	else {
+	    for (i = 0; i < StreamTestSize; i++)
+		if (received[i] != sent[i])
+		    break;
+	    if (i == StreamTestSize)
+		printf("Stream of %d bytes echoed by %d\n", StreamTestSize,
+		       farAddr);
+	    else
+		printf("Stream corrupted at byte %d\n", i);
+	}
+    } else {
+	if (!conn->Receive(received, StreamTestSize)
+	    || !conn->Send(received, StreamTestSize))
+	    printf("Connection to %d failed\n", farAddr);
+	else
+	    printf("Stream of %d bytes sent back to %d\n", StreamTestSize,
+		   farAddr);
+    }
+    fflush(stdout);
+
+    delete conn;		// wait for the other end to have it all
+    delete [] sent;
+    delete [] received;
     interrupt->Halt();
 }
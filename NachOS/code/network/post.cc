@@ -21,37 +21,18 @@
 
 #include <strings.h> /* for bzero */
 
-//----------------------------------------------------------------------
-// Mail::Mail
-//      Initialize a single mail message, by concatenating the headers to
-//	the data.
-//
-//	"pktH" -- source, destination machine ID's
-//	"mailH" -- source, destination mailbox ID's
-//	"data" -- payload data
-//----------------------------------------------------------------------
-
-Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
-{
-    ASSERT(mailH.length <= MaxMailSize);
-
-    pktHdr = pktH;
-    mailHdr = mailH;
-    bcopy(msgData, data, mailHdr.length);
-}
-
 //----------------------------------------------------------------------
 // MailBox::MailBox
 //      Initialize a single mail box within the post office, so that it
 //	can receive incoming messages.
 //
-//	Just initialize a list of messages, representing the mailbox.
+//	Just initialize a queue of messages, representing the mailbox.
 //----------------------------------------------------------------------
 
 
 MailBox::MailBox()
 { 
-    messages = new SynchList(); 
+    messages = new SynchQueue("mailbox", MailBoxSize); 
 }
 
 //----------------------------------------------------------------------
@@ -62,8 +43,15 @@ MailBox::MailBox()
 //	in the mailbox.
 //----------------------------------------------------------------------
 
+static void
+ReleasePacket(int packet)
+{
+    ((PacketBuffer *) packet)->Release();
+}
+
 MailBox::~MailBox()
 { 
+    messages->Mapcar(ReleasePacket);
     delete messages; 
 }
 
@@ -88,22 +76,23 @@ PrintHeader(PacketHeader pktHdr, MailHeader mailHdr)
 // 	Add a message to the mailbox.  If anyone is waiting for message
 //	arrival, wake them up!
 //
-//	We need to reconstruct the Mail message (by concatenating the headers
-//	to the data), to simplify queueing the message on the SynchList.
+//	The buffer the message arrived in is queued as it is, with the
+//	reference of the caller.  If the box is full, the message is lost
+//	rather than holding up the postal worker, and the mail of all the
+//	other boxes with it.
 //
-//	"pktHdr" -- source, destination machine ID's
-//	"mailHdr" -- source, destination mailbox ID's
-//	"data" -- payload message data
+//	"packet" -- headers and payload message data
 //----------------------------------------------------------------------
 
 void 
-MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, char *data)
+MailBox::Put(PacketBuffer *packet)
 { 
-    Mail *mail = new Mail(pktHdr, mailHdr, data); 
-
-    messages->Append((void *)mail);	// put on the end of the list of 
-					// arrived messages, and wake up 
-					// any waiters
+    if (!messages->TryPut((void *)packet)) {	// put on the end of the 
+					// queue of arrived messages, and 
+					// wake up a waiter
+	DEBUG('n', "Mailbox full, message dropped\n");
+	packet->Release();
+    }
 }
 
 //----------------------------------------------------------------------
@@ -120,22 +109,39 @@ MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, char *data)
 
 void 
 MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data) 
+{ 
+    PacketBuffer *packet = GetBuffer();
+
+    *pktHdr = *packet->Header();
+    *mailHdr = *MailHeaderOf(packet);
+    bcopy(MailDataOf(packet), data, mailHdr->length);
+					// copy the message data into
+					// the caller's buffer
+    packet->Release();			// we've copied out the stuff we
+					// need, we can now discard the message
+}
+
+//----------------------------------------------------------------------
+// MailBox::GetBuffer
+// 	Get a message from a mailbox, in the buffer it arrived in.  The
+//	caller reads it in place, and releases the buffer.
+//
+//	The calling thread waits if there are no messages in the mailbox.
+//----------------------------------------------------------------------
+
+PacketBuffer *
+MailBox::GetBuffer() 
 { 
     DEBUG('n', "Waiting for mail in mailbox\n");
-    Mail *mail = (Mail *) messages->Remove();	// remove message from list;
-						// will wait if list is empty
+    PacketBuffer *packet = (PacketBuffer *) messages->Get();
+					// remove message from queue;
+					// will wait if queue is empty
 
-    *pktHdr = mail->pktHdr;
-    *mailHdr = mail->mailHdr;
     if (DebugIsEnabled('n')) {
 	printf("Got mail from mailbox: ");
-	PrintHeader(*pktHdr, *mailHdr);
+	PrintHeader(*packet->Header(), *MailHeaderOf(packet));
     }
-    bcopy(mail->data, data, mail->mailHdr.length);
-					// copy the message data into
-					// the caller's buffer
-    delete mail;			// we've copied out the stuff we
-					// need, we can now discard the message
+    return packet;
 }
 
 //----------------------------------------------------------------------
@@ -171,22 +177,29 @@ static void WriteDone(int arg)
 //	  drops any packets; reliability = 0 means the network never
 //	  delivers any packets)
 //	"nBoxes" is the number of mail boxes in this Post Office
+//	"queueDepth", "bandwidth", "latency" describe the link: as many 
+//	  messages as the device queue holds can be in flight at once
 //----------------------------------------------------------------------
 
-PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
+PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes,
+		       int queueDepth, int bandwidth, int latency)
 {
 // First, initialize the synchronization with the interrupt handlers
     messageAvailable = new Semaphore("message available", 0);
-    messageSent = new Semaphore("message sent", 0);
+    sendSlots = new Semaphore("send slots", queueDepth);
     sendLock = new Lock("message send lock");
 
 // Second, initialize the mailboxes
     netAddr = addr; 
     numBoxes = nBoxes;
     boxes = new MailBox[nBoxes];
+    receivers = new MailReceiver *[nBoxes];
+    for (int i = 0; i < nBoxes; i++)
+	receivers[i] = NULL;
 
 // Third, initialize the network; tell it which interrupt handlers to call
-    network = new Network(addr, reliability, ReadAvail, WriteDone, (int) this);
+    network = new Network(addr, reliability, ReadAvail, WriteDone, (int) this,
+			  queueDepth, bandwidth, latency);
 
 
 // Finally, create a thread whose sole job is to wait for incoming messages,
@@ -205,43 +218,72 @@ PostOffice::~PostOffice()
 {
     delete network;
     delete [] boxes;
+    delete [] receivers;
     delete messageAvailable;
-    delete messageSent;
+    delete sendSlots;
     delete sendLock;
 }
 
+//----------------------------------------------------------------------
+// PostOffice::Attach
+// 	From now on, give the messages arriving in "box" to "receiver"
+//	as they arrive, rather than keeping them for Receive.  The postal
+//	worker calls MailReceiver::Deliver itself, so the receiver never
+//	waits on the mailbox.
+//
+//	"box" -- mailbox ID taken over
+//	"receiver" -- the new owner of the box, or NULL to give it back
+//
+//	Return FALSE if the box already has a receiver.
+//----------------------------------------------------------------------
+
+bool
+PostOffice::Attach(MailBoxAddress box, MailReceiver *receiver)
+{
+    ASSERT((box >= 0) && (box < numBoxes));
+    if (receiver != NULL && receivers[box] != NULL)
+	return FALSE;
+
+    receivers[box] = receiver;
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // PostOffice::PostalDelivery
 // 	Wait for incoming messages, and put them in the right mailbox.
 //
-//      Incoming messages have had the PacketHeader stripped off,
-//	but the MailHeader is still tacked on the front of the data.
+//      Incoming messages are left in the buffer the network read them
+//	in, PacketHeader and MailHeader in front of the data: the buffer
+//	itself goes to the mailbox.
 //----------------------------------------------------------------------
 
 void
 PostOffice::PostalDelivery()
 {
-    PacketHeader pktHdr;
+    PacketBuffer *packet;
     MailHeader mailHdr;
-    char *buffer = new char[MaxPacketSize];
 
     for (;;) {
         // first, wait for a message
         messageAvailable->P();	
-        pktHdr = network->Receive(buffer);
+        packet = network->ReceiveBuffer();
+	ASSERT(packet != NULL);
 
-        mailHdr = *(MailHeader *)buffer;
+        mailHdr = *MailHeaderOf(packet);
         if (DebugIsEnabled('n')) {
 	    printf("Putting mail into mailbox: ");
-	    PrintHeader(pktHdr, mailHdr);
+	    PrintHeader(*packet->Header(), mailHdr);
         }
 
 	// check that arriving message is legal!
 	ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
 	ASSERT(mailHdr.length <= MaxMailSize);
 
-	// put into mailbox
-        boxes[mailHdr.to].Put(pktHdr, mailHdr, buffer + sizeof(MailHeader));
+	// put into mailbox, or hand to the receiver owning it
+	if (receivers[mailHdr.to] != NULL)
+	    receivers[mailHdr.to]->Deliver(packet);
+	else
+	    boxes[mailHdr.to].Put(packet);
     }
 }
 
@@ -261,9 +303,32 @@ PostOffice::PostalDelivery()
 void
 PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, const char* data)
 {
-    char* buffer = new char[MaxPacketSize];	// space to hold concatenated
-						// mailHdr + data
+    PacketBuffer *packet = PacketBuffer::Get();
+
+    ASSERT(mailHdr.length <= MaxMailSize);
+    bcopy(data, MailDataOf(packet), mailHdr.length);
+    SendBuffer(pktHdr, mailHdr, packet);
+}
+
+//----------------------------------------------------------------------
+// PostOffice::SendBuffer
+// 	Put the PacketHeader and MailHeader in front of the data already
+//	in "packet", and give the buffer to the Network.
+//
+//	We only wait for a place in the device queue, and do not copy the
+//	message: the network keeps the buffer until the packet arrives,
+//	many can be on their way at the same time.  The buffer must not
+//	be modified meanwhile, except to send it again.
+//
+//	"pktHdr" -- source, destination machine ID's
+//	"mailHdr" -- source, destination mailbox ID's
+//	"packet" -- payload message data, and our reference to it
+//----------------------------------------------------------------------
 
+void
+PostOffice::SendBuffer(PacketHeader pktHdr, MailHeader mailHdr,
+		       PacketBuffer *packet)
+{
     if (DebugIsEnabled('n')) {
 	printf("Post send: ");
 	PrintHeader(pktHdr, mailHdr);
@@ -275,23 +340,20 @@ PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, const char* data)
     pktHdr.from = netAddr;
     pktHdr.length = mailHdr.length + sizeof(MailHeader);
 
-    // concatenate MailHeader and data
-    bcopy(&mailHdr, buffer, sizeof(MailHeader));
-    bcopy(data, buffer + sizeof(MailHeader), mailHdr.length);
+    // put the headers in front of the data
+    *packet->Header() = pktHdr;
+    *MailHeaderOf(packet) = mailHdr;
 
-    sendLock->Acquire();   		// only one message can be sent
+    sendSlots->P();			// wait for interrupt to tell us
+					// the device queue has room
+    sendLock->Acquire();   		// only one message can be given
 					// to the network at any one time
-    network->Send(pktHdr, buffer);
-    messageSent->P();			// wait for interrupt to tell us
-					// ok to send the next message
+    network->SendBuffer(packet);
     sendLock->Release();
-
-    delete [] buffer;			// we've sent the message, so
-					// we can delete our buffer
 }
 
 //----------------------------------------------------------------------
-// PostOffice::Send
+// PostOffice::Receive
 // 	Retrieve a message from a specific box if one is available, 
 //	otherwise wait for a message to arrive in the box.
 //
@@ -315,6 +377,22 @@ PostOffice::Receive(int box, PacketHeader *pktHdr,
     ASSERT(mailHdr->length <= MaxMailSize);
 }
 
+//----------------------------------------------------------------------
+// PostOffice::ReceiveBuffer
+// 	Same as Receive, handing over the buffer the message arrived in
+//	rather than copying it.  The caller releases the buffer.
+//
+//	"box" -- mailbox ID in which to look for message
+//----------------------------------------------------------------------
+
+PacketBuffer *
+PostOffice::ReceiveBuffer(int box)
+{
+    ASSERT((box >= 0) && (box < numBoxes));
+
+    return boxes[box].GetBuffer();
+}
+
 //----------------------------------------------------------------------
 // PostOffice::IncomingPacket
 // 	Interrupt handler, called when a packet arrives from the network.
@@ -341,6 +419,6 @@ PostOffice::IncomingPacket()
 void 
 PostOffice::PacketSent()
 { 
-    messageSent->V();
+    sendSlots->V();
 }
 
@@ -29,7 +29,8 @@
 #define POST_H
 
 #include "network.h"
-#include "synchlist.h"
+#include "synch.h"
+#include "synchqueue.h"
 
 // Mailbox address -- uniquely identifies a mailbox on a given machine.
 // A mailbox is just a place for temporary storage for messages.
@@ -53,41 +54,57 @@ class MailHeader {
 #define MaxMailSize 	(MaxPacketSize - sizeof(MailHeader))
 
 
-// The following class defines the format of an incoming/outgoing 
-// "Mail" message.  The message format is layered: 
+// A "Mail" message is kept in the PacketBuffer it arrived in, or is
+// sent from.  The message format is layered: 
 //	network header (PacketHeader) 
 //	post office header (MailHeader) 
 //	data
 
-class Mail {
-  public:
-     Mail(PacketHeader pktH, MailHeader mailH, char *msgData);
-				// Initialize a mail message by
-				// concatenating the headers to the data
-
-     PacketHeader pktHdr;	// Header appended by Network
-     MailHeader mailHdr;	// Header appended by PostOffice
-     char data[MaxMailSize];	// Payload -- message data
-};
+inline MailHeader *MailHeaderOf(PacketBuffer *packet)
+{ return (MailHeader *) packet->Payload(); }
+inline char *MailDataOf(PacketBuffer *packet)
+{ return packet->Payload() + sizeof(MailHeader); }
 
 // The following class defines a single mailbox, or temporary storage
 // for messages.   Incoming messages are put by the PostOffice into the 
 // appropriate mailbox, and these messages can then be retrieved by
-// threads on this machine.
+// threads on this machine.  The packet buffers themselves are queued,
+// the message is copied only if the receiving thread asks for it.
+// A box holds MailBoxSize messages, the next ones are dropped until
+// some are taken out.
+
+#define MailBoxSize	32
 
 class MailBox {
   public: 
     MailBox();			// Allocate and initialize mail box
     ~MailBox();			// De-allocate mail box
 
-    void Put(PacketHeader pktHdr, MailHeader mailHdr, char *data);
-   				// Atomically put a message into the mailbox
+    void Put(PacketBuffer *packet);
+   				// Atomically put a message into the mailbox,
+				// taking over the caller's reference.
+				// Never waits: drops it if the box is full
     void Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data); 
    				// Atomically get a message out of the 
 				// mailbox (and wait if there is no message 
 				// to get!)
+    PacketBuffer *GetBuffer();	// Same, without copying it: the caller
+				// gets the reference to the buffer
   private:
-    SynchList *messages;	// A mailbox is just a list of arrived messages
+    SynchQueue *messages;	// A mailbox is just a queue of arrived messages
+};
+
+// The following class defines what can take over a mailbox: the 
+// messages arriving in it are handed to Deliver as they arrive, by the 
+// postal worker thread, instead of waiting in the box.  See the 
+// connections of transport.h, and the ports of user programs.
+
+class MailReceiver {
+  public:
+    virtual ~MailReceiver() {}
+    virtual void Deliver(PacketBuffer *packet) = 0;
+				// Handle a message, taking over the 
+				// reference to its buffer
 };
 
 // The following class defines a "Post Office", or a collection of 
@@ -101,28 +118,56 @@ class MailBox {
 
 class PostOffice {
   public:
-    PostOffice(NetworkAddress addr, double reliability, int nBoxes);
+    PostOffice(NetworkAddress addr, double reliability, int nBoxes,
+	       int queueDepth, int bandwidth, int latency);
 				// Allocate and initialize Post Office
 				//   "reliability" is how many packets
 				//   get dropped by the underlying network
+				//   the others describe the link, see
+				//   network.h
     ~PostOffice();		// De-allocate Post Office data
     
     void Send(PacketHeader pktHdr, MailHeader mailHdr, const char *data);
     				// Send a message to a mailbox on a remote 
 				// machine.  The fromBox in the MailHeader is 
 				// the return box for ack's.
+    void SendBuffer(PacketHeader pktHdr, MailHeader mailHdr,
+		    PacketBuffer *packet);
+				// Same, the data being already in place in 
+				// "packet" (see MailDataOf): the network 
+				// takes over the caller's reference
     
     void Receive(int box, PacketHeader *pktHdr, 
 		MailHeader *mailHdr, char *data);
     				// Retrieve a message from "box".  Wait if
 				// there is no message in the box.
+    PacketBuffer *ReceiveBuffer(int box);
+				// Same, the caller getting the reference 
+				// to the buffer the message arrived in
+
+    NetworkAddress GetAddress() { return netAddr; }
+				// This machine's network address
+    int Latency(NetworkAddress to) { return network->Latency(to); }
+				// Ticks for a message to reach machine "to"
+    void SetLink(NetworkAddress to, double reliability, int bandwidth,
+		 int latency)
+	{ network->SetLink(to, reliability, bandwidth, latency); }
+				// Model the wire to machine "to" apart,
+				// see network.h
+    int NumBoxes() { return numBoxes; }
+
+    bool Attach(MailBoxAddress box, MailReceiver *receiver);
+				// Hand the messages arriving in "box" to
+				// "receiver" instead of keeping them, NULL
+				// to keep them again.  FALSE if the box is
+				// already taken
 
     void PostalDelivery();	// Wait for incoming messages, 
 				// and then put them in the correct mailbox
 
     void PacketSent();		// Interrupt handler, called when outgoing 
-				// packet has been put on network; next 
-				// packet can now be sent
+				// packet has been put on network; its 
+				// place in the device queue is free
     void IncomingPacket();	// Interrupt handler, called when incoming
    				// packet has arrived and can be pulled
 				// off of network (i.e., time to call 
@@ -133,9 +178,11 @@ class PostOffice {
     NetworkAddress netAddr;	// Network address of this machine
     MailBox *boxes;		// Table of mail boxes to hold incoming mail
     int numBoxes;		// Number of mail boxes
+    MailReceiver **receivers;	// Receiver attached to each box, if any
     Semaphore *messageAvailable;// V'ed when message has arrived from network
-    Semaphore *messageSent;	// V'ed when next message can be sent to network
-    Lock *sendLock;		// Only one outgoing message at a time
+    Semaphore *sendSlots;	// Places in the device queue, V'ed when
+				// a message leaves it
+    Lock *sendLock;		// Only one thread at a time queues a message
 };
 
 #endif
@@ -0,0 +1,516 @@
+// transport.cc
+//	Routines of the reliable byte stream between two mailboxes, see
+//	transport.h.
+//
+//	Three kinds of threads touch a connection: the ones sending and
+//	receiving on it, the post office worker delivering its mail, and
+//	the retransmitter thread woken by the timer interrupt.  "lock" is
+//	never held while a mail is sent, as that waits for the network.
+
+#include "copyright.h"
+#include "system.h"
+#include "transport.h"
+
+#include <strings.h> /* for bcopy */
+
+// Dummy functions because C++ can't call member functions indirectly
+static void TimerHelper(int arg)
+{ Connection *conn = (Connection *) arg; conn->Timeout(); }
+static void LingerDone(int arg)
+{ Semaphore *done = (Semaphore *) arg; done->V(); }
+
+//----------------------------------------------------------------------
+// Connection::Connection
+//	Open the end of a stream from "localBox" to mailbox "farBox" of
+//	machine "farAddr", taking over the mail arriving in "localBox".
+//	Nothing is exchanged until data is sent.
+//----------------------------------------------------------------------
+
+Connection::Connection(PostOffice *po, MailBoxAddress localBox,
+		       NetworkAddress farAddr, MailBoxAddress farBox)
+{
+    postOffice = po;
+    box = localBox;
+    toAddr = farAddr;
+    toBox = farBox;
+    lock = new Semaphore("connection lock", 1);
+    timeout = RetransmitTime + 2 * po->Latency(farAddr);
+
+    for (int i = 0; i < WindowSize; i++)
+	sendWindow[i] = recvWindow[i] = NULL;
+    sendBase = sendNext = 0;
+    windowSlots = new Semaphore("window slots", WindowSize);
+    flushing = FALSE;
+    flushed = new Semaphore("flushed", 0);
+    retries = 0;
+    failed = FALSE;
+
+    timerArmed = timerPending = FALSE;
+    deadline = 0;
+    expired = new Semaphore("retransmit timer", 0);
+    closing = FALSE;
+    timerDrained = new Semaphore("timer drained", 0);
+    retransmitterDone = new Semaphore("retransmitter done", 0);
+
+    recvNext = 0;
+    stream = new List;
+    streamOffset = streamCount = 0;
+    readerWaiting = FALSE;
+    dataAvail = new Semaphore("stream data", 0);
+
+    Thread *t = new Thread("retransmitter");
+    t->Fork(RetransmitterHelper, (int) this);
+    bool attached = postOffice->Attach(box, this);
+    ASSERT(attached);		// the box must be free
+}
+
+//----------------------------------------------------------------------
+// Connection::~Connection
+//	Wait for the data sent to be acknowledged, and then for twice
+//	the retransmit timeout, still acknowledging what the other end sends
+//	again: our last acknowledgements may have been lost.  Then stop
+//	the timer and the retransmitter, and give the mailbox back.  There
+//	is no linger if the connection failed: the other end is gone.
+//
+//	The linger is best-effort only.  Nothing tells us the other end
+//	got all its data, and the linger is counted in simulated ticks:
+//	on an idle machine they pass at once, and the machine may halt
+//	while the other end still sends again.  Its segments are then
+//	lost (see SendToSocketBatch), and it retransmits until it gives
+//	up (MaxRetransmits) or halts too.  A protocol that must know the other end is done
+//	has to exchange its own last message over the stream.
+//----------------------------------------------------------------------
+
+Connection::~Connection()
+{
+    Semaphore *lingered = new Semaphore("lingered", 0);
+    PacketBuffer *packet;
+    IntStatus oldLevel;
+
+    if (Flush()) {
+	interrupt->Schedule(LingerDone, (int) lingered, 2 * timeout,
+			    NetworkTimerInt);
+	lingered->P();
+    }
+    delete lingered;
+
+    lock->P();
+    oldLevel = interrupt->SetLevel(IntOff);
+    closing = TRUE;
+    timerArmed = FALSE;
+    if (timerPending)
+	timerDrained->P();
+    (void) interrupt->SetLevel(oldLevel);
+    lock->V();
+    expired->V();
+    retransmitterDone->P();
+    postOffice->Attach(box, NULL);
+
+    for (int i = 0; i < WindowSize; i++) {
+	if (sendWindow[i] != NULL)	// never acknowledged, if failed
+	    sendWindow[i]->Release();
+	if (recvWindow[i] != NULL)
+	    recvWindow[i]->Release();
+    }
+    while ((packet = (PacketBuffer *) stream->Remove()) != NULL)
+	packet->Release();
+    delete stream;
+    delete lock;
+    delete windowSlots;
+    delete flushed;
+    delete expired;
+    delete timerDrained;
+    delete retransmitterDone;
+    delete dataAvail;
+}
+
+//----------------------------------------------------------------------
+// Connection::Send
+//	Cut "data" into segments and send them, waiting whenever
+//	WindowSize segments are not acknowledged yet.  Return as soon as
+//	the last one is sent, not acknowledged: see Flush.  Return FALSE
+//	if the connection failed, some of the data may then be lost.
+//
+//	The data is copied once, into the buffer of its segment, kept in
+//	the window until acknowledged.
+//----------------------------------------------------------------------
+
+bool
+Connection::Send(const char *data, int size)
+{
+    PacketBuffer *packet;
+    SegmentHeader *hdr;
+    int length;
+
+    while (size > 0) {
+	length = size < MaxSegmentSize ? size : MaxSegmentSize;
+	windowSlots->P();
+	if (failed) {
+	    windowSlots->V();		// for the next caller
+	    return FALSE;
+	}
+
+	packet = PacketBuffer::Get();
+	bcopy(data, SegmentDataOf(packet), length);
+	MailHeaderOf(packet)->length = sizeof(SegmentHeader) + length;
+	hdr = SegmentHeaderOf(packet);
+	hdr->ack = 0;
+	hdr->flags = SEG_DATA;
+
+	lock->P();
+	hdr->seq = sendNext;
+	sendWindow[sendNext++ % WindowSize] = packet;
+	packet->AddRef();		// one for the window, one to send
+	if (!timerArmed)
+	    StartTimer();
+	lock->V();
+
+	Transmit(packet, length);
+	data += length;
+	size -= length;
+    }
+    return !failed;
+}
+
+//----------------------------------------------------------------------
+// Connection::Receive
+//	Copy "size" bytes of the stream to "data", waiting for them to
+//	arrive, straight from the buffers of the segments.  Reading makes
+//	room for the segments received out of order: acknowledge them if
+//	some could be moved to the stream.
+//
+//	Return FALSE if the connection failed before all the bytes came:
+//	those received in order until then are still read.
+//----------------------------------------------------------------------
+
+bool
+Connection::Receive(char *data, int size)
+{
+    PacketBuffer *packet;
+    bool advanced;
+    unsigned ack;
+    int length;
+
+    while (size > 0) {
+	lock->P();
+	while (streamCount == 0) {
+	    if (failed) {
+		lock->V();
+		return FALSE;
+	    }
+	    readerWaiting = TRUE;
+	    lock->V();
+	    dataAvail->P();
+	    lock->P();
+	}
+	packet = (PacketBuffer *) stream->Remove();
+	length = SegmentLengthOf(packet) - streamOffset;
+	if (length > size)
+	    length = size;
+	bcopy(SegmentDataOf(packet) + streamOffset, data, length);
+	streamOffset += length;
+	streamCount -= length;
+	if (streamOffset < (int) SegmentLengthOf(packet))
+	    stream->Prepend(packet);		// not read entirely
+	else {
+	    streamOffset = 0;
+	    packet->Release();
+	}
+	advanced = Drain();
+	ack = recvNext;
+	lock->V();
+
+	if (advanced)
+	    SendAck(ack);
+	data += length;
+	size -= length;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Connection::Flush
+//	Wait until every segment sent is acknowledged.  Return FALSE if
+//	the connection failed instead.
+//----------------------------------------------------------------------
+
+bool
+Connection::Flush()
+{
+    lock->P();
+    if (failed || sendBase == sendNext) {
+	lock->V();
+	return !failed;
+    }
+    flushing = TRUE;
+    lock->V();
+    flushed->P();
+    return !failed;
+}
+
+//----------------------------------------------------------------------
+// Connection::Deliver
+//	Handle a mail of the other end, from the post office worker.
+//
+//	An acknowledgement frees the window up to the segment it expects,
+//	and restarts the timer if segments are still in flight: the other
+//	end is alive, the count of timeouts starts over.  A data
+//	segment within the receive window is kept, and acknowledged with
+//	all those received before it; a duplicate is acknowledged again,
+//	as our acknowledgement was probably lost.
+//----------------------------------------------------------------------
+
+void
+Connection::Deliver(PacketBuffer *packet)
+{
+    SegmentHeader hdr = *SegmentHeaderOf(packet);
+    unsigned acked, ack;
+
+    ASSERT(MailHeaderOf(packet)->length >= sizeof(SegmentHeader));
+    lock->P();
+    if (hdr.flags & SEG_ACK) {
+	acked = hdr.ack - sendBase;
+	if (acked > 0 && acked <= sendNext - sendBase) {
+	    DEBUG('n', "Box %d: segments up to %d acknowledged\n", box,
+		  hdr.ack);
+	    retries = 0;
+	    for (; acked > 0; acked--) {
+		sendWindow[sendBase % WindowSize]->Release();
+		sendWindow[sendBase++ % WindowSize] = NULL;
+		windowSlots->V();
+	    }
+	    if (failed)
+		;			// nobody waits for it any more
+	    else if (sendBase != sendNext)
+		StartTimer();
+	    else {
+		timerArmed = FALSE;
+		if (flushing) {
+		    flushing = FALSE;
+		    flushed->V();
+		}
+	    }
+	}
+    }
+    if (!(hdr.flags & SEG_DATA)) {
+	lock->V();
+	packet->Release();
+	return;
+    }
+
+    if (hdr.seq - recvNext < WindowSize
+	&& recvWindow[hdr.seq % WindowSize] == NULL) {
+	recvWindow[hdr.seq % WindowSize] = packet;	// keep our reference
+	Drain();
+    } else
+	packet->Release();
+    ack = recvNext;
+    lock->V();
+    SendAck(ack);
+}
+
+//----------------------------------------------------------------------
+// Connection::Timeout
+//	Interrupt handler of the retransmit timer.  The deadline may have
+//	been pushed back since the interrupt was scheduled: wait for it
+//	again, otherwise wake the retransmitter up.
+//----------------------------------------------------------------------
+
+void
+Connection::Timeout()
+{
+    timerPending = FALSE;
+    if (closing) {
+	timerDrained->V();
+	return;
+    }
+    if (!timerArmed)
+	return;
+    if (stats->totalTicks < deadline) {
+	timerPending = TRUE;
+	interrupt->Schedule(TimerHelper, (int) this,
+			    deadline - stats->totalTicks, NetworkTimerInt);
+	return;
+    }
+    timerArmed = FALSE;
+    expired->V();
+}
+
+//----------------------------------------------------------------------
+// Connection::Transmit
+//	Send one mail to the other end: the segment in "packet", with
+//	"length" bytes of data.  The post office takes over the reference
+//	of the caller.
+//----------------------------------------------------------------------
+
+void
+Connection::Transmit(PacketBuffer *packet, int length)
+{
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+
+    pktHdr.to = toAddr;
+    mailHdr.to = toBox;
+    mailHdr.from = box;
+    mailHdr.length = sizeof(SegmentHeader) + length;
+    postOffice->SendBuffer(pktHdr, mailHdr, packet);
+}
+
+//----------------------------------------------------------------------
+// Connection::SendAck
+//	Tell the other end that we expect segment "ack" next.
+//----------------------------------------------------------------------
+
+void
+Connection::SendAck(unsigned ack)
+{
+    PacketBuffer *packet = PacketBuffer::Get();
+    SegmentHeader *hdr = SegmentHeaderOf(packet);
+
+    hdr->seq = 0;
+    hdr->ack = ack;
+    hdr->flags = SEG_ACK;
+    Transmit(packet, 0);
+}
+
+//----------------------------------------------------------------------
+// Connection::StartTimer
+//	Set the deadline "timeout" ticks from now.  An interrupt is only
+//	scheduled if none is pending: it will find the new deadline.
+//	The caller holds the lock.
+//----------------------------------------------------------------------
+
+void
+Connection::StartTimer()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    timerArmed = TRUE;
+    deadline = stats->totalTicks + timeout;
+    if (!timerPending) {
+	timerPending = TRUE;
+	interrupt->Schedule(TimerHelper, (int) this, timeout,
+			    NetworkTimerInt);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Connection::Fail
+//	Give up on the other end: no segment will be sent again.  Wake
+//	up the threads waiting in Flush, Send and Receive, so that they
+//	return FALSE.  The caller holds the lock.
+//----------------------------------------------------------------------
+
+void
+Connection::Fail()
+{
+    DEBUG('n', "Box %d: no acknowledgement from %d, giving up\n", box,
+	  toAddr);
+    failed = TRUE;
+    timerArmed = FALSE;
+    if (flushing) {
+	flushing = FALSE;
+	flushed->V();
+    }
+    windowSlots->V();		// passed on from sender to sender
+    if (readerWaiting) {
+	readerWaiting = FALSE;
+	dataAvail->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// Connection::Drain
+//	Append the segments received in order to the stream, as long as
+//	they fit, and wake the reader up.  Return TRUE if some were.
+//	The caller holds the lock.
+//----------------------------------------------------------------------
+
+bool
+Connection::Drain()
+{
+    PacketBuffer *packet;
+    bool advanced = FALSE;
+
+    while ((packet = recvWindow[recvNext % WindowSize]) != NULL) {
+	if (streamCount + (int) SegmentLengthOf(packet) > StreamBufferSize)
+	    break;
+	stream->Append(packet);
+	streamCount += SegmentLengthOf(packet);
+	recvWindow[recvNext++ % WindowSize] = NULL;
+	advanced = TRUE;
+    }
+    if (advanced && readerWaiting) {
+	readerWaiting = FALSE;
+	dataAvail->V();
+    }
+    return advanced;
+}
+
+//----------------------------------------------------------------------
+// Connection::Retransmitter
+//	Each time the timer expires, send again all the segments in
+//	flight (go-back-N: the receiver drops none it has room for, but
+//	we do not know which ones were lost), and restart the timer.
+//	The segments acknowledged meanwhile are skipped.
+//
+//	After MaxRetransmits timeouts with no acknowledgement in between,
+//	the connection fails instead.
+//----------------------------------------------------------------------
+
+void
+Connection::Retransmitter()
+{
+    PacketBuffer *packet;
+    unsigned seq, last;
+
+    for (;;) {
+	expired->P();
+	lock->P();
+	if (closing) {
+	    lock->V();
+	    break;
+	}
+	if (failed || sendBase == sendNext) {
+	    lock->V();			// acknowledged meanwhile
+	    continue;
+	}
+	if (++retries > MaxRetransmits) {
+	    Fail();
+	    lock->V();
+	    continue;
+	}
+	last = sendNext;
+	StartTimer();
+	seq = sendBase;
+	lock->V();
+
+	for (;;) {
+	    lock->P();
+	    if ((int) (seq - sendBase) < 0)	// acknowledged meanwhile
+		seq = sendBase;
+	    if ((int) (last - seq) <= 0) {
+		lock->V();
+		break;
+	    }
+	    packet = sendWindow[seq % WindowSize];
+	    packet->AddRef();
+	    lock->V();
+
+	    DEBUG('n', "Box %d: segment %d sent again\n", box, seq);
+	    Transmit(packet, SegmentLengthOf(packet));
+	    stats->numRetransmits++;
+	    seq++;
+	}
+    }
+    retransmitterDone->V();
+}
+
+void
+Connection::RetransmitterHelper(int arg)
+{
+    Connection *conn = (Connection *) arg;
+
+    conn->Retransmitter();
+}
@@ -0,0 +1,136 @@
+// transport.h
+//	Data structures for a reliable, ordered byte stream between two
+//	mailboxes, on top of the unreliable mail of the post office.
+//
+//	The stream is cut into segments small enough for one mail each,
+//	numbered in sequence.  The sender keeps up to WindowSize segments
+//	in flight and sends them again when they are not acknowledged
+//	within RetransmitTime; the receiver keeps the segments arriving
+//	out of order within its own window, hands the data over in order
+//	and acknowledges cumulatively: an acknowledgement tells the next
+//	segment it expects, so a lost acknowledgement is covered by the
+//	next one.
+//
+//	When the other end stops acknowledging, the sender gives up after
+//	MaxRetransmits timeouts in a row: the connection fails, and Send,
+//	Receive and Flush return FALSE from then on.  An end that only
+//	receives cannot tell a silent peer from a dead one.
+//
+//	A connection owns its local mailbox: the post office hands the
+//	mail arriving there to the connection, which never waits for it.
+//	One thread sends on a connection, one receives from it.
+//
+//	Segments stay in the packet buffers they are sent from or arrived
+//	in (see PacketBuffer): a segment is sent again from the same
+//	buffer, and the data received is only copied to the reader.
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "copyright.h"
+#include "post.h"
+#include "synch.h"
+
+#define WindowSize	8	// segments in flight, each way
+#define RetransmitTime	(4 * WindowSize * NetworkTime)	// plus twice the
+							// link latency
+#define MaxRetransmits	8	// timeouts in a row without progress
+				// before the connection fails
+#define StreamBufferSize 1024	// bytes received in order, not read yet
+
+#define SEG_DATA	1
+#define SEG_ACK		2
+
+// Prepended to the data of each mail of a connection.
+class SegmentHeader {
+  public:
+    unsigned seq;		// number of this segment (SEG_DATA)
+    unsigned ack;		// next segment expected (SEG_ACK)
+    unsigned flags;
+};
+
+// Signed: with a small MTU (-mtu), there may be no room for data at all,
+// which Initialize rejects.
+#define MaxSegmentSize	((int) MaxMailSize - (int) sizeof(SegmentHeader))
+
+inline SegmentHeader *SegmentHeaderOf(PacketBuffer *packet)
+{ return (SegmentHeader *) MailDataOf(packet); }
+inline char *SegmentDataOf(PacketBuffer *packet)
+{ return MailDataOf(packet) + sizeof(SegmentHeader); }
+inline unsigned SegmentLengthOf(PacketBuffer *packet)
+{ return MailHeaderOf(packet)->length - sizeof(SegmentHeader); }
+
+class Connection : public MailReceiver {
+  public:
+    Connection(PostOffice *po, MailBoxAddress localBox,
+	       NetworkAddress farAddr, MailBoxAddress farBox);
+				// both ends must be created, each
+				// naming the other
+    ~Connection();		// waits until all data is acknowledged,
+				// then lingers to acknowledge the last
+				// segments sent again by the other end
+				// (best-effort, see transport.cc)
+
+    bool Send(const char *data, int size);
+				// queue "size" bytes, waiting only for
+				// room in the window; FALSE if the
+				// connection failed
+    bool Receive(char *data, int size);
+				// wait for exactly "size" bytes; FALSE
+				// if the connection failed first
+    bool Flush();		// wait until all data sent is
+				// acknowledged; FALSE if it never will
+
+    void Deliver(PacketBuffer *packet);
+				// called by the post office worker for
+				// each mail arriving in the local box,
+				// with its reference to the buffer
+    void Timeout();		// interrupt handler of the retransmit timer
+
+  private:
+    PostOffice *postOffice;
+    MailBoxAddress box;
+    NetworkAddress toAddr;
+    MailBoxAddress toBox;
+    Semaphore *lock;
+    int timeout;		// RetransmitTime for this link
+
+    // Sender: segments [sendBase, sendNext) are in flight
+    PacketBuffer *sendWindow[WindowSize];
+    unsigned sendBase, sendNext;
+    Semaphore *windowSlots;	// free entries of sendWindow
+    bool flushing;
+    Semaphore *flushed;
+    int retries;		// timeouts since the last progress
+    bool failed;		// the other end stopped acknowledging
+
+    // Retransmit timer: at most one interrupt pending, reaching a
+    // deadline pushed back by each acknowledgement
+    bool timerArmed, timerPending;
+    long long deadline;
+    Semaphore *expired;
+    bool closing;
+    Semaphore *timerDrained;	// the pending interrupt saw "closing"
+    Semaphore *retransmitterDone;
+
+    // Receiver: segments before recvNext were handed over in order
+    PacketBuffer *recvWindow[WindowSize];	// NULL if not received
+    unsigned recvNext;
+    List *stream;		// segments received in order, not read yet
+    int streamOffset;		// bytes read from the first one
+    int streamCount;		// bytes not read yet
+    bool readerWaiting;
+    Semaphore *dataAvail;
+
+    void Transmit(PacketBuffer *packet, int length);
+				// send a segment, giving away a reference
+    void SendAck(unsigned ack);
+    void StartTimer();		// restart it for RetransmitTime
+    void Fail();		// give up, waking everyone up
+    bool Drain();		// move the segments received in order
+				// to "stream" while there is room
+    void Retransmitter();
+    static void RetransmitterHelper(int arg);
+};
+
+#endif // TRANSPORT_H
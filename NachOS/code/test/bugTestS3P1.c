@@ -11,7 +11,7 @@ void thread1(void* a)
 	PutChar(*str);
 	
 	finshed_threads++;
-	UserThreadExit();
+	UserThreadExit(0);
 }
 
 void thread2(void* a)
@@ -23,7 +23,7 @@ void thread2(void* a)
 	sync = 0;
 
 	finshed_threads++;
-	UserThreadExit();
+	UserThreadExit(0);
 }
 
 int main()
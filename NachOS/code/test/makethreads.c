@@ -5,7 +5,7 @@ void func(void *p) {
 
     int *m = (int*) p;
     PutInt(*m);
-    UserThreadExit();
+    UserThreadExit(0);
 }
 
 int main() {
@@ -0,0 +1,162 @@
+/* malloc.c
+ *	Size-class allocator, linked with every user program.
+ *
+ *	Small requests are rounded up to a power of two, from 8 to 2048
+ *	bytes.  Each size class keeps a list of free blocks; when it is
+ *	empty, a chunk is taken from the heap with Sbrk and cut in
+ *	blocks of that size.  malloc and free take constant time.
+ *
+ *	Larger requests get their own block, and go on a single free
+ *	list when freed, reused first fit.
+ *
+ *	Every block starts with an 8 byte header holding its size class,
+ *	so that free knows where to put it back.  Memory is never given
+ *	back to the kernel.
+ *
+ *	There is no locking: the user threads of a process must not
+ *	allocate at the same time.
+ */
+
+#include "syscall.h"
+#include "malloc.h"
+
+#define NULL ((void *) 0)
+
+#define MinShift	3	/* 8 bytes */
+#define NumClasses	9	/* up to 2048 bytes */
+#define LargeClass	NumClasses
+#define ChunkSize	4096	/* bytes taken from Sbrk at once */
+#define HeaderSize	8	/* keeps the blocks 8 byte aligned */
+
+typedef struct Header {
+	unsigned int sizeClass;	/* LargeClass for the large blocks */
+	unsigned int size;	/* usable bytes */
+} Header;
+
+typedef struct FreeBlock {
+	struct FreeBlock *next;
+} FreeBlock;
+
+static FreeBlock *freeLists[NumClasses + 1];
+static MallocStats mallocStats;
+
+/* Memory from the kernel, NULL if there is no room left */
+static void *
+MoreCore(unsigned int size)
+{
+	void *p = Sbrk(size);
+
+	if(p == (void *) -1)
+		return NULL;
+	mallocStats.numSbrks++;
+	mallocStats.heapSize += size;
+	return p;
+}
+
+static int
+SizeClass(unsigned int size)
+{
+	int c = 0;
+
+	while(c < NumClasses && (1u << (c + MinShift)) < size)
+		c++;
+	return c;
+}
+
+/* Fill the free list of class "c" with the blocks of a new chunk */
+static int
+Refill(int c)
+{
+	unsigned int blockSize = HeaderSize + (1u << (c + MinShift));
+	unsigned int n = ChunkSize / blockSize, i;
+	char *chunk = MoreCore(n * blockSize);
+	Header *h;
+
+	if(chunk == NULL)
+		return 0;
+	for(i = 0; i < n; i++){
+		h = (Header *) (chunk + i * blockSize);
+		h->sizeClass = c;
+		h->size = 1u << (c + MinShift);
+		((FreeBlock *) (h + 1))->next = freeLists[c];
+		freeLists[c] = (FreeBlock *) (h + 1);
+	}
+	return 1;
+}
+
+void *
+malloc(unsigned int size)
+{
+	FreeBlock **link, *block;
+	Header *h;
+	int c;
+
+	if(size == 0)
+		size = 1;
+	c = SizeClass(size);
+
+	if(c < NumClasses){
+		if(freeLists[c] == NULL && !Refill(c))
+			return NULL;
+		block = freeLists[c];
+		freeLists[c] = block->next;
+		h = (Header *) block - 1;
+	}
+	else{
+		/* first fit among the large blocks freed */
+		size = (size + 7) & ~7;
+		for(link = &freeLists[LargeClass]; *link != NULL;
+		    link = &(*link)->next)
+			if(((Header *) *link - 1)->size >= size)
+				break;
+		if(*link != NULL){
+			block = *link;
+			*link = block->next;
+			h = (Header *) block - 1;
+		}
+		else{
+			h = MoreCore(HeaderSize + size);
+			if(h == NULL)
+				return NULL;
+			h->sizeClass = LargeClass;
+			h->size = size;
+		}
+	}
+
+	mallocStats.numMallocs++;
+	mallocStats.inUse += h->size;
+	return h + 1;
+}
+
+void *
+calloc(unsigned int count, unsigned int size)
+{
+	char *p = malloc(count * size);
+	unsigned int i;
+
+	if(p != NULL)
+		for(i = 0; i < count * size; i++)
+			p[i] = 0;
+	return p;
+}
+
+void
+free(void *p)
+{
+	Header *h;
+	FreeBlock *block = p;
+
+	if(p == NULL)
+		return;
+	h = (Header *) p - 1;
+	block->next = freeLists[h->sizeClass];
+	freeLists[h->sizeClass] = block;
+	mallocStats.numFrees++;
+	mallocStats.inUse -= h->size;
+}
+
+void
+GetMallocStats(MallocStats *stats)
+{
+	*stats = mallocStats;
+}
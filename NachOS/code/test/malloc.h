@@ -0,0 +1,24 @@
+/* malloc.h
+ *	Dynamic memory allocation for user programs, on top of Sbrk.
+ *	See malloc.c.
+ */
+
+#ifndef MALLOC_H
+#define MALLOC_H
+
+void *malloc(unsigned int size);
+void *calloc(unsigned int count, unsigned int size);
+void free(void *p);
+
+/* Counters for measuring the allocator */
+typedef struct MallocStats {
+	int numMallocs;
+	int numFrees;
+	int numSbrks;		/* calls to Sbrk */
+	int heapSize;		/* bytes obtained from Sbrk */
+	int inUse;		/* bytes of the blocks allocated */
+} MallocStats;
+
+void GetMallocStats(MallocStats *stats);
+
+#endif /* MALLOC_H */
@@ -0,0 +1,38 @@
+#include "syscall.h"
+
+// Map a file, turn it to upper case through the mapping, and print it
+// back with read (step5 flavor only: the stub file system has no file
+// descriptors)
+
+#define Size 300
+
+int main()
+{
+	char buf[Size];
+	char *p;
+	int fd, i;
+
+	for(i = 0; i < Size; i++)
+		buf[i] = 'a' + i % 26;
+	fd = open("mmapfile", 1, Size);
+	if(fd < 0){
+		PutString("open failed\n");
+		return 1;
+	}
+	write(fd, buf, Size);
+
+	p = (char *) Mmap(fd, 0, Size);
+	if(p == (char *) -1){
+		PutString("Mmap failed\n");
+		return 1;
+	}
+	for(i = 0; i < Size; i++)
+		p[i] = p[i] - 'a' + 'A';
+	Munmap(p);
+
+	lseek(fd, 0);
+	read(fd, Size);
+	PutChar('\n');
+	close(fd);
+	return 0;
+}
@@ -4,7 +4,7 @@ void thread1(void* a)
 {
 	int *val = (int*) a;
 	PutInt(*val);
-	UserThreadExit();
+	UserThreadExit(0);
 }
 
 int main()
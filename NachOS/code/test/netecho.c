@@ -0,0 +1,65 @@
+#include "syscall.h"
+
+// Chat between two machines through a port, waiting with Select for
+// either a message or a line typed on the console: each line is sent
+// to the peer, which prints it and sends it back.
+// (try it with nachos-withnet -m 0 -x netecho and -m 1 -x netecho,
+// each typing lines, an empty one to quit)
+
+#define Box 1
+#define Peer(self) (1 - (self))
+#define MaxLine 40
+
+int main()
+{
+	PortAddress peer, from;
+	SelectEntry entries[2];
+	char line[MaxLine + 1];
+	int port, n;
+
+	port = PortOpen(Box, PORT_NONBLOCK);
+	if(port < 0){
+		PutString("PortOpen failed, is the network on?\n");
+		return 1;
+	}
+	PutString("Machine number? ");
+	GetInt(&peer.machine);
+	peer.machine = Peer(peer.machine);
+	peer.box = Box;
+
+	entries[0].kind = SELECT_PORT;
+	entries[0].id = port;
+	entries[1].kind = SELECT_CONSOLE;
+	entries[1].id = 0;
+	for(;;){
+		if(Select(entries, 2, -1) < 0)
+			break;
+		if(entries[0].ready){
+			while((n = PortReceive(port, &from, line, MaxLine)) > 0){
+				line[n] = '\0';
+				if(line[0] == '>'){	// our line coming back
+					PutString("echo: ");
+					PutString(line + 1);
+					PutString("\n");
+					continue;
+				}
+				PutString("peer: ");
+				PutString(line + 1);
+				PutString("\n");
+				line[0] = '>';	// send it back, marked as an echo
+				PortSend(port, &from, line, n);
+			}
+		}
+		if(entries[1].ready){
+			line[0] = ' ';
+			GetString(line + 1, MaxLine - 1);
+			if(line[1] == '\0')	// empty line or end of input
+				break;
+			for(n = 0; line[n] != '\0'; n++)
+				;
+			PortSend(port, &peer, line, n);
+		}
+	}
+	PortClose(port);
+	return 0;
+}
@@ -0,0 +1,34 @@
+#include "syscall.h"
+
+// Select on a port nobody sends to: it must give up after its timeout
+// and return 0, even though no other thread is running.  Without the
+// network, the console is watched instead (type nothing).
+
+#define Box 2
+#define Timeout 1000
+
+int main()
+{
+	SelectEntry entry;
+	int port, n;
+
+	port = PortOpen(Box, 0);
+	if(port >= 0){
+		entry.kind = SELECT_PORT;
+		entry.id = port;
+	}else{
+		entry.kind = SELECT_CONSOLE;
+		entry.id = 0;
+	}
+	n = Select(&entry, 1, Timeout);
+	if(port >= 0)
+		PortClose(port);
+	if(n != 0 || entry.ready){
+		PutString("Select did not time out: ");
+		PutInt(n);
+		PutString("\n");
+		return 1;
+	}
+	PutString("Select timed out\n");
+	return 0;
+}
@@ -19,7 +19,7 @@ void thread1(void* a)
 	PutString("Ending P2T1\n");
 	sync = 1;
 	
-	UserThreadExit();
+	UserThreadExit(0);
 }
 
 void thread2(void* a)
@@ -40,7 +40,7 @@ void thread2(void* a)
 	while(sync == 0);
 	PutString("Ending P2T2\n");
 
-	UserThreadExit();
+	UserThreadExit(0);
 }
 
 int main()
@@ -0,0 +1,25 @@
+#include "syscall.h"
+
+int counter = 5;
+
+int main()
+{
+	int pid;
+
+	pid = Fork();
+	if(pid == 0){
+		// the child gets its own copy of counter
+		counter = 100;
+		PutString("child: ");
+		PutInt(counter);
+		PutChar('\n');
+		Exit(0);
+	}
+
+	UserWaitPid(pid);
+	PutString("parent: ");
+	PutInt(counter);
+	PutChar('\n');
+
+	return 0;
+}
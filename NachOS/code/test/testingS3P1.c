@@ -13,7 +13,7 @@ void thread1(void* a)
 	PutChar('\n');
 	
 	finshed_threads++;
-	UserThreadExit();
+	UserThreadExit(0);
 }
 
 void thread2(void* a)
@@ -27,7 +27,7 @@ void thread2(void* a)
 	sync = 0;
 
 	finshed_threads++;
-	UserThreadExit();
+	UserThreadExit(0);
 }
 
 int main()
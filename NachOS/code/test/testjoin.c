@@ -10,7 +10,7 @@ void thread1(void* a)
 	PutChar('f');
 	// PutChar('\n');
 
-	UserThreadExit();
+	UserThreadExit(7);	/* exit status collected by UserThreadJoin */
 }
 
 void thread2(void* a)
@@ -23,7 +23,13 @@ void thread2(void* a)
 	PutChar('F');
 	// PutChar('\n');
 
-	UserThreadExit();
+	UserThreadExit(0);
+}
+
+int thread3(void* a)
+{
+	PutChar('x');
+	return 42;	/* exit status collected by UserThreadJoin */
 }
 
 int main()
@@ -33,12 +39,20 @@ int main()
 	if (tid1 < 0 )
 		Halt();
 
-	UserThreadJoin(tid1);
+	PutInt(UserThreadJoin(tid1));
 	
 	int tid2;
 	tid2 = UserThreadCreate(thread2, 0);
 	if (tid2 < 0 )
 		Halt();
 
+	UserThreadDetach(tid2);
+
+	int tid3;
+	tid3 = UserThreadCreate((void (*)(void *)) thread3, 0);
+	if (tid3 < 0 )
+		Halt();
+
+	PutInt(UserThreadJoin(tid3));
 	PutChar('J');
 }
\ No newline at end of file
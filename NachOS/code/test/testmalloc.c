@@ -0,0 +1,55 @@
+#include "syscall.h"
+#include "malloc.h"
+
+// Allocate and free blocks of random sizes, check their contents, and
+// print the allocator counters
+
+#define NumBlocks 32
+#define Rounds 8
+
+int main()
+{
+	char *blocks[NumBlocks];
+	int sizes[NumBlocks];
+	unsigned int seed = 1;
+	int round, i, j, errors = 0;
+	MallocStats stats;
+
+	for(i = 0; i < NumBlocks; i++)
+		blocks[i] = 0;
+
+	for(round = 0; round < Rounds; round++)
+		for(i = 0; i < NumBlocks; i++){
+			if(blocks[i] != 0){
+				for(j = 0; j < sizes[i]; j++)
+					if(blocks[i][j] != (char) (i + j))
+						errors++;
+				free(blocks[i]);
+			}
+			seed = seed * 1103515245 + 12345;
+			sizes[i] = 1 + (seed >> 16) % 600;
+			blocks[i] = malloc(sizes[i]);
+			if(blocks[i] == 0){
+				PutString("malloc failed\n");
+				return 1;
+			}
+			for(j = 0; j < sizes[i]; j++)
+				blocks[i][j] = i + j;
+		}
+
+	GetMallocStats(&stats);
+	PutString("errors ");
+	PutInt(errors);
+	PutString(", mallocs ");
+	PutInt(stats.numMallocs);
+	PutString(", frees ");
+	PutInt(stats.numFrees);
+	PutString(", sbrks ");
+	PutInt(stats.numSbrks);
+	PutString(", heap ");
+	PutInt(stats.heapSize);
+	PutString(", in use ");
+	PutInt(stats.inUse);
+	PutChar('\n');
+	return 0;
+}
@@ -7,7 +7,7 @@
 	close(fd);
  	rm("hola");
 
- 	UserThreadExit();
+ 	UserThreadExit(0);
  }
 
 
@@ -10,7 +10,7 @@ void thread1(void* a)
 	PutChar('5');
 	// PutChar('\n');
 
-	UserThreadExit();
+	UserThreadExit(0);
 }
 
 void thread2(void* a)
@@ -23,7 +23,7 @@ void thread2(void* a)
 	PutChar('}');
 	// PutChar('\n');
 
-	UserThreadExit();
+	UserThreadExit(0);
 }
 
 int main()
@@ -0,0 +1,25 @@
+#!/bin/sh
+# vmbench.sh
+#	Run the paging workloads with each page replacement policy and
+#	several memory sizes, and print the results as CSV.
+#
+#	Run it from the build directory, once the kernels and the user
+#	programs are compiled:
+#		../test/vmbench.sh > vmbench.csv
+#	The kernel, the workloads and the memory sizes can be changed:
+#		NACHOS=./nachos-withtlb MEMS="32 64" ../test/vmbench.sh
+
+NACHOS=${NACHOS:-./nachos-withstub}
+WORKLOADS=${WORKLOADS:-"vmseq vmrand vmloop matmult"}
+POLICIES=${POLICIES:-"fifo clock random"}
+MEMS=${MEMS:-"32 48 64 96"}
+
+echo "workload,policy,frames,pagesize,faults,evictions,pageouts,dirtywritebacks,pageins,ticks"
+for w in $WORKLOADS; do
+    for p in $POLICIES; do
+	for m in $MEMS; do
+	    $NACHOS -policy $p -mem $m -vmcsv -x $w \
+		| sed -n "s/^vmstats,/$w,/p"
+	done
+    done
+done
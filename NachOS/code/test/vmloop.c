@@ -0,0 +1,32 @@
+/* vmloop.c
+ *	Paging workload: a small array used all the time, and a larger one
+ *	swept in a loop.
+ *
+ *	Policies that look at the use bits (clock) keep the small array in
+ *	memory, FIFO keeps evicting it.
+ */
+
+#include "syscall.h"
+
+#define HotSize	256		/* 1 KB of ints */
+#define ColdSize 3072		/* 12 KB of ints */
+#define Passes	4
+
+int hot[HotSize];
+int cold[ColdSize];
+
+int
+main ()
+{
+    int pass, i, sum = 0;
+
+    for (pass = 0; pass < Passes; pass++)
+	for (i = 0; i < ColdSize; i++)
+	  {
+	      cold[i] += hot[i % HotSize];
+	      hot[(i * 7) % HotSize] += i;
+	      sum += cold[i];
+	  }
+
+    Exit (sum);
+}
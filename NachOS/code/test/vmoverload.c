@@ -0,0 +1,29 @@
+#include "syscall.h"
+
+// Start more paging workloads at once than physical memory can hold:
+// the admission control queues some of them, and suspends some others
+// if the machine thrashes, instead of failing the ForkExec
+// (try it with -mem 48 -d a)
+
+#define NumProcesses 6
+
+int main()
+{
+	int i;
+	int pids[NumProcesses];
+
+	for(i = 0; i < NumProcesses; i++){
+		pids[i] = ForkExec("vmloop");
+		if(pids[i] < 0){
+			PutString("ForkExec failed\n");
+			return 1;
+		}
+	}
+	for(i = 0; i < NumProcesses; i++){
+		UserWaitPid(pids[i]);
+		PutString("Process ");
+		PutInt(pids[i]);
+		PutString(" done\n");
+	}
+	return 0;
+}
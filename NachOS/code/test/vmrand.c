@@ -0,0 +1,33 @@
+/* vmrand.c
+ *	Paging workload: read and write random elements of an array larger
+ *	than physical memory.
+ *
+ *	There is no locality to exploit, every policy should fault about
+ *	as often.
+ */
+
+#include "syscall.h"
+
+#define Size	4096		/* 16 KB of ints */
+#define Accesses 20000
+
+int array[Size];
+
+int
+main ()
+{
+    unsigned int seed = 12345;
+    int i, n, sum = 0;
+
+    for (n = 0; n < Accesses; n++)
+      {
+	  seed = seed * 1103515245 + 12345;	/* linear congruential */
+	  i = (seed >> 16) % Size;
+	  if (n % 4 == 0)
+	      array[i] = n;	/* one write every four reads */
+	  else
+	      sum += array[i];
+      }
+
+    Exit (sum);
+}
@@ -0,0 +1,29 @@
+/* vmseq.c
+ *	Paging workload: sweep an array larger than physical memory
+ *	from one end to the other, a few times.
+ *
+ *	Every page is touched once per pass, no replacement policy can
+ *	do better than evicting the page used the longest time ago.
+ */
+
+#include "syscall.h"
+
+#define Size	4096		/* 16 KB of ints */
+#define Passes	4
+
+int array[Size];
+
+int
+main ()
+{
+    int pass, i, sum = 0;
+
+    for (pass = 0; pass < Passes; pass++)
+	for (i = 0; i < Size; i++)
+	  {
+	      array[i] += i;
+	      sum += array[i];
+	  }
+
+    Exit (sum);
+}
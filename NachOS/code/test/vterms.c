@@ -0,0 +1,25 @@
+#include "syscall.h"
+
+// Run an interactive session on each virtual terminal: every shell
+// reads from and writes to its own terminal only
+// (try it with -vt in1 out1 -vt in2 out2, the files being FIFOs or ptys)
+
+#define NumSessions 2
+
+int main()
+{
+	int i;
+	int pids[NumSessions];
+
+	for(i = 0; i < NumSessions; i++){
+		pids[i] = ForkExecTerm("shell", i + 1);
+		if(pids[i] < 0){
+			PutString("ForkExecTerm failed, not enough terminals\n");
+			return 1;
+		}
+	}
+	for(i = 0; i < NumSessions; i++)
+		UserWaitPid(pids[i]);
+	PutString("All sessions ended\n");
+	return 0;
+}
@@ -10,10 +10,18 @@
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
 //              -s -x <nachos file> -c <consoleIn> <consoleOut>
+//              -mem <number of pages> -pgsz <page size> -pt2
+//              -policy <fifo|clock|random> -swap <pages> -vmcsv
+//              -colors <number of colors> -reserve <number of pages>
+//              -cburst <chars> -vt <terminal in> <terminal out>
+//              -tlb <entries> -tlbways <entries per set> -tlblru
 //              -f -cp <unix file> <nachos file>
 //              -p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -m <machine id>
+//              -mtu <bytes> -nq <packets> -nbw <bytes per 1000 ticks> -nlat <ticks>
+//              -link <machine id> <reliability> <bytes per 1000 ticks> <ticks>
 //              -o <other machine id>
+//              -cluster <description file>
 //              -z
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
@@ -24,6 +32,30 @@
 //    -s causes user programs to be executed in single-step mode
 //    -x runs a user program
 //    -c tests the console
+//    -mem sets the number of physical pages of the machine (32)
+//    -pgsz sets the page size in bytes, a power of two (the sector size)
+//    -pt2 gives user programs sparse address spaces, with two-level
+//         page tables
+//    -policy sets the page replacement policy (fifo)
+//    -swap sets the size of the swap space in pages (1024)
+//    -vmcsv prints the paging statistics on one line when halting,
+//         for test/vmbench.sh
+//    -colors sets the number of page colors of the frame allocator (1)
+//    -reserve sets the number of frames kept for the page faults of
+//         running processes (0)
+//    -cburst sets the number of characters the console moves per
+//         interrupt (16)
+//    -vt adds a terminal reading from and writing to the given host
+//         files (FIFOs or ptys for interactive sessions), numbered
+//         from 1 in the order given; terminal 0 is stdin/stdout.
+//         Processes run on the terminal of their parent, or the one
+//         given to ForkExecTerm.
+//
+//  USE_TLB
+//    -tlb sets the number of TLB entries (4)
+//    -tlbways sets the associativity of the TLB (fully associative)
+//    -tlblru replaces the least recently used TLB entry on a miss,
+//         instead of a random one
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
@@ -36,8 +68,23 @@
 //
 //  NETWORK
 //    -n sets the network reliability
-//    -m sets this machine's host id (needed for the network)
+//    -m sets this machine's host id, below 64 (needed for the network)
+//    -mtu sets the size of the largest packet, headers included; all
+//         the machines must use the same (64).  It must leave room for
+//         at least one byte of data after the headers of a stream segment
+//    -nq sets the number of packets the network device queues (1)
+//    -nbw sets the bandwidth of the link, in bytes per 1000 ticks
+//         (one packet of 64 bytes per NetworkTime)
+//    -nlat sets the ticks a packet takes to reach the other machine,
+//         after being put on the wire (0)
+//    -link sets the reliability, bandwidth and latency of the wire to
+//         one machine apart from the others, set by -l, -nbw and -nlat
 //    -o runs a simple test of the Nachos network software
+//    -ot runs a test of the reliable stream (transport.h), use it with
+//        -l below 1 to see lost segments sent again
+//    -cluster starts the machines described in the file, each in its
+//         own process, and waits for them (see network/cluster.h); it
+//         must be the only flag
 //
 //  NOTE -- flags are ignored until the relevant assignment.
 //  Some of the flags are interpreted here; some in system.cc.
@@ -52,6 +99,9 @@
 
 #include "utility.h"
 #include "system.h"
+#ifdef NETWORK
+#include "cluster.h"
+#endif
 
 
 // External functions used by this file
@@ -59,7 +109,7 @@
 extern void ThreadTest (void), Copy (const char *unixFile, const char *nachosFile);
 extern void Print (char *file), PerformanceTest (void);
 extern void StartProcess (char *file), ConsoleTest (char *in, char *out), SynchConsoleTest (char *in, char *out);
-extern void MailTest (int networkID);
+extern void MailTest (int networkID), StreamTest (int networkID);
 
 //----------------------------------------------------------------------
 // main
@@ -81,6 +131,12 @@ main (int argc, char **argv)
     int argCount;		// the number of arguments
     // for a particular command
 
+#ifdef NETWORK
+    if (argc == 3 && !strcmp (argv[1], "-cluster"))
+	return RunCluster (argv[0], argv[2]);	// the launcher itself is
+						// not a machine
+#endif
+
     DEBUG ('t', "Entering main");
     (void) Initialize (argc, argv);
 
@@ -192,6 +248,13 @@ main (int argc, char **argv)
 		MailTest (atoi (*(argv + 1)));
 		argCount = 2;
 	    }
+	  else if (!strcmp (*argv, "-ot"))
+	    {
+		ASSERT (argc > 1);
+		Delay (2);
+		StreamTest (atoi (*(argv + 1)));
+		argCount = 2;
+	    }
 #endif // NETWORK
       }
 
@@ -59,6 +59,32 @@ Scheduler::ReadyToRun (Thread * thread)
     readyList->Append ((void *) thread);
 }
 
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// Scheduler::NumReadyThreads
+//      Return the number of threads of "space" on the ready list, which
+//      keeps its order.
+//----------------------------------------------------------------------
+
+int
+Scheduler::NumReadyThreads (AddrSpace *space)
+{
+    List *scanned = new List;
+    Thread *thread;
+    int n = 0;
+
+    while ((thread = (Thread *) readyList->Remove ()) != NULL)
+      {
+	  if (thread->space == space)
+	      n++;
+	  scanned->Append ((void *) thread);
+      }
+    delete readyList;
+    readyList = scanned;
+    return n;
+}
+#endif
+
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
 //      Return the next thread to be scheduled onto the CPU.
@@ -126,11 +152,7 @@ Scheduler::Run (Thread * nextThread)
     // we need to delete its carcass.  Note we cannot delete the thread
     // before now (for example, in Thread::Finish()), because up to this
     // point, we were still running on the old thread's stack!
-    if (threadToBeDestroyed != NULL)
-      {
-	  delete threadToBeDestroyed;
-	  threadToBeDestroyed = NULL;
-      }
+    ReapFinishedThreads ();
 
 #ifdef USER_PROGRAM
     if (currentThread->space != NULL)
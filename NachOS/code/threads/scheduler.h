@@ -28,6 +28,10 @@ class Scheduler
     // list, if any, and return thread.
     void Run (Thread * nextThread);	// Cause nextThread to start running
     void Print ();		// Print contents of ready list
+#ifdef USER_PROGRAM
+    int NumReadyThreads (AddrSpace *space);	// of "space", on the
+    // ready list
+#endif
 
   private:
       List * readyList;		// queue of threads that are ready to run,
@@ -0,0 +1,170 @@
+// synchqueue.cc
+//      Routines for a bounded queue between producer and consumer
+//      threads.
+//
+//      Nachos threads switch only when they wait, or when interrupts
+//      are turned back on: the ring is updated with interrupts off, so
+//      that neither another thread nor an interrupt handler can come in
+//      between.  Threads wait the way they do for a Lock, sleeping in a
+//      list the other side wakes them from.
+
+#include "copyright.h"
+#include "synchqueue.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// SynchQueue::SynchQueue
+//      Allocate the ring of a queue of "queueSize" items, empty to
+//      start with.
+//----------------------------------------------------------------------
+
+SynchQueue::SynchQueue (const char *debugName, int queueSize)
+{
+    ASSERT (queueSize > 0);
+    name = debugName;
+    ring = new void *[queueSize];
+    size = queueSize;
+    first = 0;
+    numItems = 0;
+    getters = new List;
+    putters = new List;
+}
+
+//----------------------------------------------------------------------
+// SynchQueue::~SynchQueue
+//      De-allocate the queue.  Nobody may be waiting on it.
+//----------------------------------------------------------------------
+
+SynchQueue::~SynchQueue ()
+{
+    ASSERT (getters->IsEmpty () && putters->IsEmpty ());
+    delete [] ring;
+    delete getters;
+    delete putters;
+}
+
+//----------------------------------------------------------------------
+// SynchQueue::Append, SynchQueue::Remove
+//      Add an item at the end of the ring, remove the first one, and
+//      wake up a thread waiting for the other side, if any.  Called
+//      with interrupts off.
+//----------------------------------------------------------------------
+
+void
+SynchQueue::Append (void *item)
+{
+    Thread *thread;
+
+    ring[(first + numItems) % size] = item;
+    numItems++;
+    thread = (Thread *) getters->Remove ();
+    if (thread != NULL)
+	scheduler->ReadyToRun (thread);
+}
+
+void *
+SynchQueue::Remove ()
+{
+    void *item = ring[first];
+    Thread *thread;
+
+    first = (first + 1) % size;
+    numItems--;
+    thread = (Thread *) putters->Remove ();
+    if (thread != NULL)
+	scheduler->ReadyToRun (thread);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// SynchQueue::Put
+//      Append "item" to the end of the queue, waiting for room if it is
+//      full.
+//----------------------------------------------------------------------
+
+void
+SynchQueue::Put (void *item)
+{
+    IntStatus oldLevel = interrupt->SetLevel (IntOff);
+
+    while (numItems == size)
+      {
+	  putters->Append ((void *) currentThread);
+	  currentThread->Sleep ();
+      }
+    Append (item);
+    (void) interrupt->SetLevel (oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchQueue::Get
+//      Remove the first item of the queue, waiting for one if it is
+//      empty.
+//----------------------------------------------------------------------
+
+void *
+SynchQueue::Get ()
+{
+    IntStatus oldLevel = interrupt->SetLevel (IntOff);
+    void *item;
+
+    while (numItems == 0)
+      {
+	  getters->Append ((void *) currentThread);
+	  currentThread->Sleep ();
+      }
+    item = Remove ();
+    (void) interrupt->SetLevel (oldLevel);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// SynchQueue::TryPut
+//      Append "item" to the end of the queue, unless it is full.
+//      Return FALSE then.  Never waits.
+//----------------------------------------------------------------------
+
+bool
+SynchQueue::TryPut (void *item)
+{
+    IntStatus oldLevel = interrupt->SetLevel (IntOff);
+    bool put = numItems < size;
+
+    if (put)
+	Append (item);
+    (void) interrupt->SetLevel (oldLevel);
+    return put;
+}
+
+//----------------------------------------------------------------------
+// SynchQueue::TryGet
+//      Remove the first item of the queue, NULL if it is empty.  Never
+//      waits.
+//----------------------------------------------------------------------
+
+void *
+SynchQueue::TryGet ()
+{
+    IntStatus oldLevel = interrupt->SetLevel (IntOff);
+    void *item = NULL;
+
+    if (numItems > 0)
+	item = Remove ();
+    (void) interrupt->SetLevel (oldLevel);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// SynchQueue::Mapcar
+//      Apply "func" to every item in the queue, first to last.
+//----------------------------------------------------------------------
+
+void
+SynchQueue::Mapcar (VoidFunctionPtr func)
+{
+    IntStatus oldLevel = interrupt->SetLevel (IntOff);
+
+    for (int i = 0; i < numItems; i++)
+	(*func) ((int) ring[(first + i) % size]);
+    (void) interrupt->SetLevel (oldLevel);
+}
@@ -0,0 +1,55 @@
+// synchqueue.h 
+//      Data structures for a bounded queue handing items from producer
+//      threads to consumer threads, any number of each.
+//
+//      The items are kept in a ring of fixed size, allocated once:
+//      putting or getting an item allocates nothing, and takes no lock.
+//      A thread waits only to get from an empty queue, or to put into a
+//      full one.  Interrupt handlers can use the Try versions, which
+//      never wait.
+//
+//      Unlike SynchList, this does not need condition variables.
+
+#ifndef SYNCHQUEUE_H
+#define SYNCHQUEUE_H
+
+#include "copyright.h"
+#include "list.h"
+
+class SynchQueue
+{
+  public:
+    SynchQueue (const char *debugName, int queueSize);
+				// initialize an empty queue of
+				// "queueSize" items at most
+    ~SynchQueue ();		// de-allocate the queue, the items left
+    // are the caller's
+
+    void Put (void *item);	// append item to the end of the queue,
+    // waiting while it is full, and wake up a thread waiting in Get
+    void *Get ();		// remove the first item of the queue,
+    // waiting while it is empty, and wake up a thread waiting in Put
+    bool TryPut (void *item);	// same, FALSE if the queue is full
+    void *TryGet ();		// same, NULL if the queue is empty
+
+    int NumItems ()
+    {
+	return numItems;
+    }
+    void Mapcar (VoidFunctionPtr func);	// apply function to every item
+    // in the queue
+
+  private:
+    const char *name;		// for debugging
+    void **ring;		// the items, from ring[first], wrapping
+    int size;
+    int first;
+    int numItems;
+    List *getters;		// threads waiting for an item
+    List *putters;		// threads waiting for room
+
+    void Append (void *item);	// the queue is not full
+    void *Remove ();		// the queue is not empty
+};
+
+#endif // SYNCHQUEUE_H
@@ -8,12 +8,15 @@
 #include "copyright.h"
 #include "system.h"
 #include "../userprog/synchconsole.h"
+#ifdef NETWORK
+#include "transport.h"
+#endif
 
 // This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
 
 Thread *currentThread;		// the thread we are running now
-Thread *threadToBeDestroyed;	// the thread that just finished
+List *threadsToBeDestroyed;	// finished threads not yet reaped
 Scheduler *scheduler;		// the ready list
 Interrupt *interrupt;		// interrupt status
 Statistics *stats;		// performance metrics
@@ -31,7 +34,17 @@ SynchDisk *synchDisk;
 #ifdef USER_PROGRAM		// requires either FILESYS or FILESYS_STUB
 Machine *machine;		// user program memory and registers
 SynchConsole *synchconsole;
+SynchConsole *terminals[MaxTerminals];
+int numTerminals;
 FrameProvider *frameProvider;
+ExecutableCache *execCache;	// code pages shared between processes
+bool twoLevelPageTables = FALSE;
+Pager *pager;			// page replacement and swap space
+AdmissionControl *admission;	// queues ForkExec under memory pressure
+static bool printVMStats = FALSE;	// -vmcsv
+#ifdef USE_TLB
+TLBManager *tlbManager;		// refills the TLB
+#endif
 int procounter;  //count the number of processes created
 int livepro; //count the number of live processes
 Semaphore *interthread_lock; //lock to protect sections between threads
@@ -91,6 +104,16 @@ Initialize (int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    int pagerPolicy = PAGER_FIFO;	// page replacement policy
+    int numSwapPages = DefaultNumSwapPages;
+    int numColors = DefaultNumColors;	// frame allocator
+    int numReserved = DefaultReservedFrames;
+    int consoleBurst = DefaultConsoleBurst;
+    char *terminalIn[MaxTerminals], *terminalOut[MaxTerminals];
+    int numTerminalFiles = 0;
+#endif
+#ifdef USE_TLB
+    int tlbPolicy = TLB_RANDOM;	// TLB replacement policy
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
@@ -98,6 +121,11 @@ Initialize (int argc, char **argv)
 #ifdef NETWORK
     double rely = 1;		// network reliability
     int netname = 0;		// UNIX socket name
+    int netDepth = DefaultNetworkDepth;	// the link, see network.h
+    int netBandwidth = DefaultNetworkBandwidth;
+    int netLatency = DefaultNetworkLatency;
+    char **linkArgs[MaxMachines];	// -link flags, applied once the network
+    int numLinkArgs = 0;	// is there
 #endif
 
     for (argc--, argv++; argc > 0; argc -= argCount, argv += argCount)
@@ -124,6 +152,81 @@ Initialize (int argc, char **argv)
 #ifdef USER_PROGRAM
 	  if (!strcmp (*argv, "-s"))
 	      debugUserProg = TRUE;
+	  else if (!strcmp (*argv, "-mem"))
+	    {
+		ASSERT (argc > 1);
+		numPhysPages = atoi (*(argv + 1));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-pgsz"))
+	    {
+		ASSERT (argc > 1);
+		pageSize = atoi (*(argv + 1));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-pt2"))
+	      twoLevelPageTables = TRUE;
+	  else if (!strcmp (*argv, "-policy"))
+	    {
+		ASSERT (argc > 1);
+		if (!strcmp (*(argv + 1), "clock"))
+		    pagerPolicy = PAGER_CLOCK;
+		else if (!strcmp (*(argv + 1), "random"))
+		    pagerPolicy = PAGER_RANDOM;
+		else
+		    ASSERT (!strcmp (*(argv + 1), "fifo"));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-swap"))
+	    {
+		ASSERT (argc > 1);
+		numSwapPages = atoi (*(argv + 1));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-vmcsv"))
+	      printVMStats = TRUE;
+	  else if (!strcmp (*argv, "-colors"))
+	    {
+		ASSERT (argc > 1);
+		numColors = atoi (*(argv + 1));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-reserve"))
+	    {
+		ASSERT (argc > 1);
+		numReserved = atoi (*(argv + 1));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-cburst"))
+	    {
+		ASSERT (argc > 1);
+		consoleBurst = atoi (*(argv + 1));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-vt"))
+	    {
+		ASSERT (argc > 2 && numTerminalFiles + 1 < MaxTerminals);
+		terminalIn[numTerminalFiles] = *(argv + 1);
+		terminalOut[numTerminalFiles] = *(argv + 2);
+		numTerminalFiles++;
+		argCount = 3;
+	    }
+#endif
+#ifdef USE_TLB
+	  if (!strcmp (*argv, "-tlb"))
+	    {
+		ASSERT (argc > 1);
+		tlbSize = atoi (*(argv + 1));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-tlbways"))
+	    {
+		ASSERT (argc > 1);
+		tlbWays = atoi (*(argv + 1));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-tlblru"))
+	      tlbPolicy = TLB_LRU;
 #endif
 #ifdef FILESYS_NEEDED
 	  if (!strcmp (*argv, "-f"))
@@ -142,6 +245,36 @@ Initialize (int argc, char **argv)
 		netname = atoi (*(argv + 1));
 		argCount = 2;
 	    }
+	  else if (!strcmp (*argv, "-mtu"))
+	    {
+		ASSERT (argc > 1);
+		wireSize = atoi (*(argv + 1));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-nq"))
+	    {
+		ASSERT (argc > 1);
+		netDepth = atoi (*(argv + 1));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-nbw"))
+	    {
+		ASSERT (argc > 1);
+		netBandwidth = atoi (*(argv + 1));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-nlat"))
+	    {
+		ASSERT (argc > 1);
+		netLatency = atoi (*(argv + 1));
+		argCount = 2;
+	    }
+	  else if (!strcmp (*argv, "-link"))
+	    {
+		ASSERT (argc > 4 && numLinkArgs < MaxMachines);
+		linkArgs[numLinkArgs++] = argv + 1;
+		argCount = 5;
+	    }
 #endif
       }
 
@@ -152,7 +285,7 @@ Initialize (int argc, char **argv)
     if (randomYield)		// start the timer (if needed)
 	timer = new Timer (TimerInterruptHandler, 0, randomYield);
 
-    threadToBeDestroyed = NULL;
+    threadsToBeDestroyed = new List;
 
     // We didn't explicitly allocate the current thread we are running in.
     // But if it ever tries to give up the CPU, we better have a Thread
@@ -165,9 +298,22 @@ Initialize (int argc, char **argv)
 
 #ifdef USER_PROGRAM
     machine = new Machine (debugUserProg);	// this must come first
-	synchconsole = new SynchConsole(NULL,NULL);
-	unsigned int numPages = divRoundUp (MemorySize, PageSize);
-	frameProvider = new FrameProvider(numPages);
+	synchconsole = new SynchConsole(NULL,NULL,consoleBurst);
+	terminals[0] = synchconsole;
+	for (numTerminals = 1; numTerminals <= numTerminalFiles; numTerminals++)
+	    terminals[numTerminals] =
+		new SynchConsole(terminalIn[numTerminals - 1],
+				 terminalOut[numTerminals - 1], consoleBurst);
+	frameProvider = new FrameProvider(NumPhysPages, numColors, numReserved);
+	execCache = new ExecutableCache();
+	pager = new Pager(pagerPolicy, numSwapPages);
+	admission = new AdmissionControl();
+	frameProvider->StartZeroing();
+	pager->StartCompaction();
+	admission->StartChecker();
+#ifdef USE_TLB
+	tlbManager = new TLBManager(tlbPolicy);
+#endif
 
     procounter = 0;
 	livepro = 1; //main process is live
@@ -187,7 +333,14 @@ Initialize (int argc, char **argv)
 #endif
 
 #ifdef NETWORK
-    postOffice = new PostOffice (netname, rely, 10);
+    // room for the headers of a stream segment and some data
+    ASSERT (MaxSegmentSize > 0);
+    ASSERT (netname >= 0 && netname < MaxMachines);
+    postOffice = new PostOffice (netname, rely, 10, netDepth, netBandwidth,
+				 netLatency);
+    for (int i = 0; i < numLinkArgs; i++)
+	postOffice->SetLink (atoi (linkArgs[i][0]), atof (linkArgs[i][1]),
+			     atoi (linkArgs[i][2]), atoi (linkArgs[i][3]));
 #endif
 }
 
@@ -204,7 +357,11 @@ Cleanup ()
 #endif
 
 #ifdef USER_PROGRAM
+    if (printVMStats)
+	pager->PrintCSV ();
     delete machine;
+	for (int i = 1; i < numTerminals; i++)
+	    delete terminals[i];
 	delete synchconsole;
 #endif
 
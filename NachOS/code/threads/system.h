@@ -22,7 +22,7 @@ extern void Initialize (int argc, char **argv);	// Initialization,
 extern void Cleanup ();		// Cleanup, called when
 						// Nachos is done.
 extern Thread *currentThread;	// the thread holding the CPU
-extern Thread *threadToBeDestroyed;	// the thread that just finished
+extern List *threadsToBeDestroyed;	// finished threads not yet reaped
 extern Scheduler *scheduler;	// the ready list
 extern Interrupt *interrupt;	// interrupt status
 extern Statistics *stats;	// performance metrics
@@ -34,8 +34,22 @@ extern Timer *timer;		// the hardware alarm clock
 extern Machine *machine;	// user program memory and registers
 #include "synchconsole.h"
 extern SynchConsole *synchconsole;
+#define MaxTerminals 8
+extern SynchConsole *terminals[MaxTerminals]; // terminal 0 is synchconsole,
+extern int numTerminals;	// the others are added with -vt
 #include "frameprovider.h"
 extern FrameProvider *frameProvider;
+#include "execcache.h"
+extern ExecutableCache *execCache;
+extern bool twoLevelPageTables;	// sparse address spaces (-pt2)
+#include "pager.h"
+extern Pager *pager;
+#include "admission.h"
+extern AdmissionControl *admission;
+#ifdef USE_TLB
+#include "tlbmanager.h"
+extern TLBManager *tlbManager;
+#endif
 #define MAX_STRING_SIZE 256  //Local Buffer Size
 #define MaxNumPro 256
 extern int procounter;  //count the number of processes created
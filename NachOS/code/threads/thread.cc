@@ -32,6 +32,10 @@
 					// execution stack, for detecting
 					// stack overflows
 
+// Execution stacks of deleted threads, ready to be handed to new ones
+static int *stackCache[StackCacheSize];
+static int numCachedStacks = 0;
+
 //----------------------------------------------------------------------
 // Thread::Thread
 //      Initialize a thread control block, so that we can then call
@@ -75,7 +79,12 @@ Thread::~Thread ()
 
     ASSERT (this != currentThread);
     if (stack != NULL)
-	DeallocBoundedArray ((char *) stack, StackSize * sizeof (int));
+      {
+	  if (numCachedStacks < StackCacheSize)
+	      stackCache[numCachedStacks++] = stack;
+	  else
+	      DeallocBoundedArray ((char *) stack, StackSize * sizeof (int));
+      }
 }
 
 //----------------------------------------------------------------------
@@ -157,12 +166,12 @@ Thread::CheckOverflow ()
 //
 //      NOTE: we don't immediately de-allocate the thread data structure
 //      or the execution stack, because we're still running in the thread
-//      and we're still on the stack!  Instead, we set "threadToBeDestroyed",
-//      so that Scheduler::Run() will call the destructor, once we're
-//      running in the context of a different thread.
+//      and we're still on the stack!  Instead, we put it on
+//      "threadsToBeDestroyed", so that Scheduler::Run() will call the
+//      destructor, once we're running in the context of a different thread.
 //
 //      NOTE: we disable interrupts, so that we don't get a time slice
-//      between setting threadToBeDestroyed, and going to sleep.
+//      between queueing the thread, and going to sleep.
 //----------------------------------------------------------------------
 
 //
@@ -174,12 +183,7 @@ Thread::Finish ()
 
     DEBUG ('t', "Finishing thread \"%s\"\n", getName ());
 
-    // LB: Be careful to guarantee that no thread to be destroyed
-    // is ever lost
-    ASSERT (threadToBeDestroyed == NULL);
-    // End of addition
-
-    threadToBeDestroyed = currentThread;
+    threadsToBeDestroyed->Append ((void *) currentThread);
     Sleep ();			// invokes SWITCH
     // not reached
 }
@@ -288,11 +292,7 @@ SetupThreadState ()
   // done each time a thread is scheduled, either by SWITCH, or by
   // getting created.
 
-  if (threadToBeDestroyed != NULL)
-    {
-      delete threadToBeDestroyed;
-      threadToBeDestroyed = NULL;
-    }
+  ReapFinishedThreads ();
 
 #ifdef USER_PROGRAM
 
@@ -324,6 +324,22 @@ SetupThreadState ()
 
 // End of addition
 
+//----------------------------------------------------------------------
+// ReapFinishedThreads
+//      Delete, in one pass, every thread that finished since the last
+//      context switch.  Called once we run on a stack that is not one
+//      of theirs.
+//----------------------------------------------------------------------
+
+void
+ReapFinishedThreads ()
+{
+    Thread *thread;
+
+    while ((thread = (Thread *) threadsToBeDestroyed->Remove ()) != NULL)
+	delete thread;
+}
+
 void
 ThreadPrint (int arg)
 {
@@ -346,7 +362,10 @@ ThreadPrint (int arg)
 void
 Thread::StackAllocate (VoidFunctionPtr func, int arg)
 {
-    stack = (int *) AllocBoundedArray (StackSize * sizeof (int));
+    if (numCachedStacks > 0)
+	stack = stackCache[--numCachedStacks];
+    else
+	stack = (int *) AllocBoundedArray (StackSize * sizeof (int));
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
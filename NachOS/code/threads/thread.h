@@ -63,6 +63,14 @@ enum ThreadStatus
 // external function, dummy routine whose sole job is to call Thread::Print
 extern void ThreadPrint (int arg);
 
+// Delete every finished thread waiting in threadsToBeDestroyed.
+// Must not be called while running on the stack of one of them.
+extern void ReapFinishedThreads ();
+
+// Number of host execution stacks kept for reuse once their thread is
+// deleted, to save the allocation and the mprotect calls on each Fork
+#define StackCacheSize	8
+
 class AddrSpace;
 
 // The following class defines a "thread control block" -- which
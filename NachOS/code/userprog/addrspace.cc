@@ -48,7 +48,7 @@ SwapHeader (NoffHeader * noffH)
 
 
 static ExceptionType
-DoTranslatiton(int virtAddr, int* physAddr, TranslationEntry *pageTable, unsigned int pageTableSize)
+DoTranslatiton(int virtAddr, int* physAddr, AddrSpace *space)
 {
     unsigned int vpn, offset;
     TranslationEntry *entry;
@@ -62,19 +62,20 @@ DoTranslatiton(int virtAddr, int* physAddr, TranslationEntry *pageTable, unsigne
     vpn = (unsigned) virtAddr / PageSize;
     offset = (unsigned) virtAddr % PageSize;
     
-    if (vpn >= pageTableSize) {
-        DEBUG('a', "virtual page # %d too large for page table size %d!\n", virtAddr, pageTableSize);
+    if (vpn >= space->GetNumPages()) {
+        DEBUG('a', "virtual page # %d too large for page table size %d!\n", virtAddr, space->GetNumPages());
         return AddressErrorException;
-    } else if (!pageTable[vpn].valid) {
-        DEBUG('a', "virtual page # %d is not valid!\n", virtAddr, pageTableSize);
+    }
+    entry = space->PageEntry(vpn);
+    if (entry == NULL || !entry->valid) {
+        DEBUG('a', "virtual page # %d is not valid!\n", virtAddr);
         return PageFaultException;
     }
-    entry = &pageTable[vpn];
     pageFrame = entry->physicalPage;
 
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
-    if (pageFrame >= NumPhysPages) { 
+    if (pageFrame >= (unsigned) NumPhysPages) { 
         DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
         return BusErrorException;
     }
@@ -88,49 +89,85 @@ DoTranslatiton(int virtAddr, int* physAddr, TranslationEntry *pageTable, unsigne
 
 
 
-static bool
-WriteMachineMem(int addr, int value, TranslationEntry *pageTable, unsigned int pageTableSize)
-{
-    ExceptionType exception;
-    int physicalAddress;
-     
-    DEBUG('a', "Writing VA 0x%x, value 0x%x\n", addr, value);
-
-    exception = DoTranslatiton(addr, &physicalAddress, pageTable, pageTableSize);
-    if (exception != NoException) {
-        machine->RaiseException(exception, addr);
-        return FALSE;
-    }
-    machine->mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
-    
-    return TRUE;
-}
-
-
-
 //----------------------------------------------------------------------
 // ReadAtVirtual
-//      Write to the virtal address space
+//      Write to the virtal address space, one page at a time
 //----------------------------------------------------------------------
 static void 
 ReadAtVirtual(  OpenFile *executable, 
                 int virtualaddr, 
                 int numBytes,
                 int position,
-                TranslationEntry *pageTable,
-                unsigned pageTableSize){
+                AddrSpace *space){
 
     char tempBuffer[numBytes];
-    int i;
-
-    //machine->pageTable = pageTable;
-    //machine->pageTableSize = numPages;
+    ExceptionType exception;
+    int physicalAddress;
+    int done, chunk;
 
     executable->ReadAt(tempBuffer, numBytes, position);
 
-    for(i = 0; i < numBytes; i++){
-        WriteMachineMem(virtualaddr + i, tempBuffer[i], pageTable, pageTableSize);   
-    }   
+    for(done = 0; done < numBytes; done += chunk){
+        chunk = PageSize - (virtualaddr + done) % PageSize;
+        if(chunk > numBytes - done)
+            chunk = numBytes - done;
+
+        exception = DoTranslatiton(virtualaddr + done, &physicalAddress, space);
+        if (exception != NoException) {
+            machine->RaiseException(exception, virtualaddr + done);
+            return;
+        }
+        bcopy(&tempBuffer[done], &machine->mainMemory[physicalAddress], chunk);
+    }
+}
+
+//----------------------------------------------------------------------
+// SharedCodePages
+//      Compute the range of virtual pages of a program that only hold
+//      code, and can therefore be shared between processes.  The last
+//      page of the code segment also holds the start of the data.
+//----------------------------------------------------------------------
+
+void
+SharedCodePages (NoffHeader * noffH, unsigned int *firstPage,
+		 unsigned int *numPages)
+{
+    unsigned int first, end;
+
+    *firstPage = 0;
+    *numPages = 0;
+    if (noffH->code.size <= 0)
+	return;
+    first = divRoundUp (noffH->code.virtualAddr, PageSize);
+    end = (noffH->code.virtualAddr + noffH->code.size) / PageSize;
+    if (end > first)
+      {
+	  *firstPage = first;
+	  *numPages = end - first;
+      }
+}
+
+//----------------------------------------------------------------------
+// ImagePages
+//      Number of virtual pages of a program holding code or initialized
+//      data.  The pages after them (uninitialized data and stack) are
+//      only given a frame when they are first touched.
+//----------------------------------------------------------------------
+
+unsigned int
+ImagePages (NoffHeader * noffH)
+{
+    unsigned int numImagePages = 0;
+
+    if (noffH->code.size > 0)
+	numImagePages = divRoundUp (noffH->code.virtualAddr + noffH->code.size,
+				    PageSize);
+    if (noffH->initData.size > 0 &&
+	divRoundUp (noffH->initData.virtualAddr + noffH->initData.size,
+		    PageSize) > (int) numImagePages)
+	numImagePages = divRoundUp (noffH->initData.virtualAddr
+				    + noffH->initData.size, PageSize);
+    return numImagePages;
 }
 
 //----------------------------------------------------------------------
@@ -152,20 +189,44 @@ AddrSpace::AddrSpace (OpenFile * executable)
 {
     NoffHeader noffH;
     unsigned int i, size;
+    unsigned int codeFirstPage, codeNumPages, numImagePages;
+    CachedExecutable *cached;
+    TranslationEntry *entry;
+    int fileId, length, hugeFrame = -1;
 
-    executable->ReadAt ((char *) &noffH, sizeof (noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) &&
-	(WordToHost (noffH.noffMagic) == NOFFMAGIC))
-	SwapHeader (&noffH);
+// a program run recently is still in the executable cache
+    fileId = executable->HeaderSector ();
+    length = executable->Length ();
+    cached = execCache->Find (fileId, length);
+    if (cached != NULL)
+	noffH = cached->noffH;
+    else
+      {
+	  executable->ReadAt ((char *) &noffH, sizeof (noffH), 0);
+	  if ((noffH.noffMagic != NOFFMAGIC) &&
+	      (WordToHost (noffH.noffMagic) == NOFFMAGIC))
+	      SwapHeader (&noffH);
+      }
     ASSERT (noffH.noffMagic == NOFFMAGIC);
 
 // how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size + UserStackSize;	// we need to increase the size
-    // to leave room for the stack
+    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size
+	+ MapAreaSize + UserStackSize;	// we need to increase the size
+    // to leave room for the mappings and the stack
     numPages = divRoundUp (size, PageSize);
+    if (twoLevelPageTables
+	&& numPages < (unsigned) divRoundUp (SparseAddrSpaceSize, PageSize))
+	numPages = divRoundUp (SparseAddrSpaceSize, PageSize);
     size = numPages * PageSize;
+    numImagePages = ImagePages (&noffH);
+    if (numImagePages > numPages)
+	numImagePages = numPages;
+    mapAreaFirst = divRoundUp (noffH.code.size + noffH.initData.size
+			       + noffH.uninitData.size, PageSize);
+    mapAreaEnd = numPages - divRoundUp (UserStackSize, PageSize);
+    brk = mapAreaFirst * PageSize;	// empty heap
 
-    ASSERT (numPages <= NumPhysPages);	// check we're not trying
+    ASSERT (numImagePages <= (unsigned) NumPhysPages);	// check we're not trying
     // to run anything too big --
     // at least until we have
     // virtual memory
@@ -173,24 +234,68 @@ AddrSpace::AddrSpace (OpenFile * executable)
     DEBUG ('a', "Initializing address space, num pages %d, size %d\n",
 	   numPages, size);
 
-// first, set up the translation 
-    pageTable = new TranslationEntry[numPages];
-    for (i = 0; i < numPages; i++)
+// the pages holding nothing but code are read-only, and shared with
+// the other address spaces running the same file
+    SharedCodePages (&noffH, &codeFirstPage, &codeNumPages);
+
+// first, set up the translation, the pages after the image are
+// zero-filled on demand.  Each whole group of HugePageFactor pages of
+// the image gets an aligned run of frames if there is one, so that it
+// can be mapped by a huge page.
+    AllocPageTable (twoLevelPageTables);
+    for (i = 0; i < numImagePages; i++)
       {
-	  pageTable[i].virtualPage = i;	// for now, virtual page # = phys page #
-	  pageTable[i].physicalPage = frameProvider->GetEmptyFrame(AS_ORDERED);
-	  pageTable[i].valid = TRUE;
-	  pageTable[i].use = FALSE;
-	  pageTable[i].dirty = FALSE;
-	  pageTable[i].readOnly = FALSE;	// if the code segment was entirely on 
-	  // a separate page, we could set its 
-	  // pages to be read-only
+	  entry = NewPageEntry (i);
+	  if (i % HugePageFactor == 0)
+	    {
+		hugeFrame = -1;
+		if (i + HugePageFactor <= numImagePages
+		    && (cached == NULL || cached->frames == NULL
+			|| i + HugePageFactor <= codeFirstPage
+			|| i >= codeFirstPage + codeNumPages))
+		    hugeFrame = frameProvider->GetHugeFrame (FALSE);
+	    }
+	  if (cached != NULL && cached->frames != NULL
+	      && i >= codeFirstPage && i < codeFirstPage + codeNumPages)
+	    {
+		entry->physicalPage = cached->frames[i - codeFirstPage];
+		frameProvider->AddFrameRef(entry->physicalPage);
+	    }
+	  else if (hugeFrame >= 0)
+	      entry->physicalPage = hugeFrame + i % HugePageFactor;
+	  else
+	      entry->physicalPage = pager->GetFrame(this, i, FALSE);
+	  ASSERT ((int) entry->physicalPage >= 0);	// see CheckPhysicalSpace
+	  entry->valid = TRUE;
+	  entry->readOnly = (i >= codeFirstPage
+			     && i < codeFirstPage + codeNumPages);
       }
 
 
-// zero out the entire address space, to zero the unitialized data segment 
-// and the stack segment
-    //bzero (machine->mainMemory, size);
+// the unitialized data segment and the stack segment are zeroed
+// page by page, when they are first touched (see HandlePageFault)
+
+    if (cached != NULL)
+      {
+// copy the cached pages, except the shared ones
+	  DEBUG ('a', "Loading %d cached pages\n", cached->numImagePages);
+	  for (i = 0; i < cached->numImagePages; i++)
+	    {
+		entry = PageEntry (i);
+		if (cached->frames != NULL && entry->readOnly)
+		    continue;
+		bcopy (&cached->image[i * PageSize],
+		       &machine->mainMemory[entry->physicalPage * PageSize],
+		       PageSize);
+	    }
+	  execCache->ShareFrames (cached, this);
+	  execCache->Release (cached);
+
+	  PromoteHugePages (0, numImagePages);
+	  SetPageOwners ();
+	  InitProcessState ();
+	  return;
+      }
 
 // then, copy in the code and data segments into memory
     if (noffH.code.size > 0)
@@ -201,8 +306,7 @@ AddrSpace::AddrSpace (OpenFile * executable)
                 noffH.code.virtualAddr, 
                 noffH.code.size,
                 noffH.code.inFileAddr,
-                pageTable,
-                numPages);
+                this);
 	  //executable->ReadAt (&(machine->mainMemory[noffH.code.virtualAddr]),
 		//	      noffH.code.size, noffH.code.inFileAddr);
       }
@@ -214,34 +318,354 @@ AddrSpace::AddrSpace (OpenFile * executable)
                 noffH.initData.virtualAddr, 
                 noffH.initData.size,
                 noffH.initData.inFileAddr,
-                pageTable,
-                numPages);
+                this);
 	  //executable->ReadAt (&
 	//		      (machine->mainMemory
 	//		       [noffH.initData.virtualAddr]),
 	//		      noffH.initData.size, noffH.initData.inFileAddr);
       }
 
+// keep the image for the next runs of the program
+    execCache->Insert (fileId, length, &noffH, this, numImagePages,
+		       codeFirstPage, codeNumPages);
+
+    PromoteHugePages (0, numImagePages);
+    SetPageOwners ();
+    InitProcessState ();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+//      Create the address space of the child of a Fork.  The child
+//      shares every frame of "parent": writable pages are mapped
+//      read-only in both address spaces and copied on the first write
+//      to them (see HandleReadOnlyFault).
+//
+//      "stackSlot" is the user stack slot of the forking thread, the
+//      child's single thread keeps running on it.
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace (AddrSpace *parent, int stackSlot)
+{
+    unsigned int i;
+    TranslationEntry *entry, *parentEntry;
+
+    numPages = parent->numPages;
+    mapAreaFirst = parent->mapAreaFirst;
+    mapAreaEnd = parent->mapAreaEnd;
+    brk = parent->brk;
+    AllocPageTable (parent->pageDirectory != NULL);
+    for (i = 0; i < numPages; i++)
+      {
+	  parentEntry = parent->PageEntry (i);
+	  if (parentEntry == NULL)
+	      continue;		// still zero-filled on demand
+	  if (parent->Info (i)->mapping != NULL)
+	      continue;		// mappings are not inherited
+	  if (!parentEntry->valid)
+	    {
+		if (parent->Info (i)->swapSlot < 0)
+		    continue;
+		// swapped out, the child gets its own copy
+		entry = NewPageEntry (i);
+		entry->readOnly = parentEntry->readOnly;
+		Info (i)->copyOnWrite = parent->Info (i)->copyOnWrite;
+		Info (i)->swapSlot =
+		    pager->DuplicateSwapSlot (parent->Info (i)->swapSlot);
+		ASSERT (Info (i)->swapSlot >= 0);
+		continue;
+	    }
+	  entry = NewPageEntry (i);
+	  *entry = *parentEntry;
+	  entry->use = FALSE;
+	  frameProvider->AddFrameRef(entry->physicalPage);
+	  if (!entry->readOnly)
+	    {
+		parentEntry->readOnly = TRUE;
+		parent->Info (i)->copyOnWrite = TRUE;
+		entry->readOnly = TRUE;
+		Info (i)->copyOnWrite = TRUE;
+	    }
+	  else
+	      Info (i)->copyOnWrite = parent->Info (i)->copyOnWrite;
+      }
+
+    DEBUG ('a', "Forked address space, num pages %d\n", numPages);
+#ifdef USE_TLB
+    tlbManager->Flush (parent->asid);	// its pages became read-only
+#endif
+
+    InitProcessState ();
+    console = parent->console;
+    if (stackSlot != 0)
+	stackSlots->Mark(stackSlot);
+}
+
+//----------------------------------------------------------------------
+// InitPageEntry, InitPageInfo
+//      An unmapped page, zero-filled on demand.
+//----------------------------------------------------------------------
+
+static void
+InitPageEntry (TranslationEntry *entry, unsigned int vpn)
+{
+    entry->virtualPage = vpn;
+    entry->physicalPage = -1;
+    entry->valid = FALSE;
+    entry->readOnly = FALSE;
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+    entry->huge = FALSE;
+}
+
+static void
+InitPageInfo (PageInfo *info)
+{
+    info->copyOnWrite = FALSE;
+    info->swapSlot = -1;
+    info->mapping = NULL;
+    info->busy = FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocPageTable
+//      Allocate an empty page table for "numPages" pages, linear or
+//      two-level.  With a two-level page table, only the directory is
+//      allocated here.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::AllocPageTable (bool twoLevel)
+{
+    unsigned int i, numDirEntries;
+
+    pageTable = NULL;
+    pageDirectory = NULL;
+    pageInfo = NULL;
+    pageInfoDir = NULL;
+    if (!twoLevel)
+      {
+	  pageTable = new TranslationEntry[numPages];
+	  pageInfo = new PageInfo[numPages];
+	  for (i = 0; i < numPages; i++)
+	    {
+		InitPageEntry (&pageTable[i], i);
+		InitPageInfo (&pageInfo[i]);
+	    }
+	  return;
+      }
+
+    numDirEntries = divRoundUp (numPages, SecondLevelSize);
+    pageDirectory = new TranslationEntry *[numDirEntries];
+    pageInfoDir = new PageInfo *[numDirEntries];
+    for (i = 0; i < numDirEntries; i++)
+      {
+	  pageDirectory[i] = NULL;
+	  pageInfoDir[i] = NULL;
+      }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageEntry
+//      Return the translation of virtual page "vpn", or NULL if there
+//      is none because its second-level table was never allocated.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+AddrSpace::PageEntry (unsigned int vpn)
+{
+    if (vpn >= numPages)
+	return NULL;
+    if (pageTable != NULL)
+	return &pageTable[vpn];
+    if (pageDirectory[vpn / SecondLevelSize] == NULL)
+	return NULL;
+    return &pageDirectory[vpn / SecondLevelSize][vpn % SecondLevelSize];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::NewPageEntry
+//      Return the translation of virtual page "vpn", allocating the
+//      second-level table that holds it if needed.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+AddrSpace::NewPageEntry (unsigned int vpn)
+{
+    unsigned int dir = vpn / SecondLevelSize;
+    unsigned int i;
+
+    ASSERT (vpn < numPages);
+    if (pageTable == NULL && pageDirectory[dir] == NULL)
+      {
+	  DEBUG ('a', "Second-level page table %d allocated\n", dir);
+	  pageDirectory[dir] = new TranslationEntry[SecondLevelSize];
+	  pageInfoDir[dir] = new PageInfo[SecondLevelSize];
+	  for (i = 0; i < SecondLevelSize; i++)
+	    {
+		InitPageEntry (&pageDirectory[dir][i], dir * SecondLevelSize + i);
+		InitPageInfo (&pageInfoDir[dir][i]);
+	    }
+      }
+    return PageEntry (vpn);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Info
+//      Return the kernel bookkeeping of "vpn".  The page must have a
+//      translation.
+//----------------------------------------------------------------------
+
+PageInfo *
+AddrSpace::Info (unsigned int vpn)
+{
+    if (pageTable != NULL)
+	return &pageInfo[vpn];
+    ASSERT (pageInfoDir[vpn / SecondLevelSize] != NULL);
+    return &pageInfoDir[vpn / SecondLevelSize][vpn % SecondLevelSize];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SetPageOwners
+//      The program is loaded, its pages can be evicted from now on.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SetPageOwners ()
+{
+    unsigned int i;
+    TranslationEntry *entry;
+
+    for (i = 0; i < numPages; i++)
+      {
+	  entry = PageEntry (i);
+	  if (entry != NULL && entry->valid)
+	      pager->SetOwner (entry->physicalPage, this, i);
+      }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::HugePageEntry
+//      Return the entry of the first page of the huge page holding
+//      "vpn", or NULL if "vpn" is mapped on its own.  The translation,
+//      use and dirty bits of the whole huge page are kept there.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+AddrSpace::HugePageEntry (unsigned int vpn)
+{
+    TranslationEntry *entry = PageEntry (vpn - vpn % HugePageFactor);
+
+    if (entry == NULL || !entry->valid || !entry->huge)
+	return NULL;
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PromoteHugePages
+//      Map by a huge page each aligned group of HugePageFactor pages,
+//      between "first" and "end", that sits in an aligned run of frames
+//      with the same protection, and is neither copy-on-write nor
+//      mapped from a file.
+//
+//      The entries of the other pages of a group are kept up to date
+//      but unused, until the group is split again.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::PromoteHugePages (unsigned int first, unsigned int end)
+{
+    unsigned int head, i;
+    TranslationEntry *headEntry, *entry;
+
+    for (head = divRoundUp (first, HugePageFactor) * HugePageFactor;
+	 head + HugePageFactor <= end; head += HugePageFactor)
+      {
+	  headEntry = PageEntry (head);
+	  for (i = 0; i < HugePageFactor; i++)
+	    {
+		entry = PageEntry (head + i);
+		if (entry == NULL || !entry->valid
+		    || entry->physicalPage != headEntry->physicalPage + i
+		    || entry->readOnly != headEntry->readOnly
+		    || Info (head + i)->copyOnWrite
+		    || Info (head + i)->mapping != NULL)
+		    break;
+	    }
+	  if (i < HugePageFactor || headEntry->physicalPage % HugePageFactor != 0)
+	      continue;
+	  DEBUG ('a', "Virtual pages %d-%d mapped by a huge page at frame %d\n",
+		 head, head + HugePageFactor - 1, headEntry->physicalPage);
+	  headEntry->huge = TRUE;
+      }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SplitHugePage
+//      Map the pages of the huge page holding "vpn", if any, one by one
+//      again, before one of them is changed.  They all inherit the use
+//      and dirty bits of the huge page.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SplitHugePage (unsigned int vpn)
+{
+    TranslationEntry *headEntry = HugePageEntry (vpn);
+    unsigned int i;
+
+    if (headEntry == NULL)
+	return;
+#ifdef USE_TLB
+    tlbManager->Invalidate (asid, headEntry->virtualPage); // brings the bits back
+#endif
+    DEBUG ('a', "Huge page at virtual page %d split\n",
+	   headEntry->virtualPage);
+    headEntry->huge = FALSE;
+    for (i = 1; i < HugePageFactor; i++)
+      {
+	  PageEntry (headEntry->virtualPage + i)->use |= headEntry->use;
+	  PageEntry (headEntry->virtualPage + i)->dirty |= headEntry->dirty;
+      }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::InitProcessState
+//      Initialize the per-process bookkeeping (threads, semaphores,
+//      open files) of a new address space.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::InitProcessState ()
+{
+    unsigned int i;
+
+#ifdef USE_TLB
+    asid = tlbManager->AllocAsid ();
+#endif
     userSemCounter = 1;
     tidcounter = 0;
     livethreads = 0;
-    lock_tidcounter = new Semaphore("lock_tidcounter",1);
-    lock_livethreads = new Semaphore("lock_livethreads",1);
-
-    for(i=0; i < MaxNumThreads; i++){
-        createdThreads[i] = new Semaphore("ThreadSem", 0);
-        activeThreads[i] = 0;
-    }   
+    exiting = FALSE;
+    killed = FALSE;
+    pageWaiters = 0;
+    pageReleased = new Semaphore("page released", 0);
+    lock_threads = new Semaphore("lock_threads",1);
+    allThreadsDone = new Semaphore("allThreadsDone",0);
+    userThreads = NULL;
+    mappings = NULL;
+    console = synchconsole;	// the caller may change it
+    stackSlots = new BitMap(NumStackSlots);
+    stackSlots->Mark(0);	// the main thread runs on the top slot
 
 
-    
-
     interthread_lock->P();
     pro = procounter;
     interthread_lock->V();
 
     for (i = 0; i < numPages; i++){
-        DEBUG ('p', "virtual Page %d, PhysicalPage %d\n", i, pageTable[i].physicalPage);
+        TranslationEntry *entry = PageEntry(i);
+        if (entry != NULL && entry->valid)
+            DEBUG ('p', "virtual Page %d, PhysicalPage %d\n", i, entry->physicalPage);
     }
 
     #ifndef FILESYS_STUB
@@ -263,10 +687,33 @@ AddrSpace::AddrSpace (OpenFile * executable)
 
 AddrSpace::~AddrSpace ()
 {
+#ifdef USE_TLB
+  if (asid != NoAsid)		// FreeFrames did not give it back
+    tlbManager->FreeAsid (asid);
+#endif
   // LB: Missing [] for delete
   // delete pageTable;
   delete [] pageTable;
   // End of modification
+  delete [] pageInfo;
+  if (pageDirectory != NULL)
+    {
+      for (unsigned int i = 0; i < divRoundUp (numPages, SecondLevelSize); i++)
+        {
+          delete [] pageDirectory[i];
+          delete [] pageInfoDir[i];
+        }
+      delete [] pageDirectory;
+      delete [] pageInfoDir;
+    }
+
+  // Threads that were never joined nor detached
+  while (userThreads != NULL)
+      RemoveUserThread(userThreads);
+  delete stackSlots;
+  delete lock_threads;
+  delete allThreadsDone;
+  delete pageReleased;
 }
 
 //----------------------------------------------------------------------
@@ -326,8 +773,15 @@ AddrSpace::SaveState ()
 void
 AddrSpace::RestoreState ()
 {
+#ifdef USE_TLB
+    // the TLB entries of the other address spaces are tagged with
+    // their own asid, no need to flush them
+    machine->currentAsid = asid;
+#else
     machine->pageTable = pageTable;
+    machine->pageDirectory = pageDirectory;
     machine->pageTableSize = numPages;
+#endif
 }
 
 
@@ -346,7 +800,9 @@ AddrSpace::GetNumPages ()
 
 //----------------------------------------------------------------------
 // AddrSpace::FreeFrames
-//      Deallocate Memory
+//      Deallocate Memory, and the swap space used by the address space.
+//      The process is done: its TLB entries go, and its id can be used
+//      by the next process.
 //----------------------------------------------------------------------
 
 void
@@ -354,12 +810,599 @@ AddrSpace::FreeFrames ()
 {
     unsigned int i;
 
+    while (mappings != NULL)
+        Munmap(mappings->firstPage * PageSize);	// writes back dirty pages
     for (i = 0; i < numPages; i++)
     {
-        frameProvider->ReleaseFrame(pageTable[i].physicalPage);
+        TranslationEntry *entry = PageEntry(i);
+        if (entry == NULL)
+            continue;
+        if (entry->valid) {
+            pager->Disown(entry->physicalPage, this);
+            frameProvider->ReleaseFrame(entry->physicalPage);
+            entry->valid = FALSE;
+            entry->huge = FALSE;
+        }
+        if (Info(i)->swapSlot >= 0) {
+            pager->FreeSwapSlot(Info(i)->swapSlot);
+            Info(i)->swapSlot = -1;
+        }
+    }
+#ifdef USE_TLB
+    if (asid != NoAsid) {
+        tlbManager->FreeAsid(asid);	// flushes its entries, which
+        asid = NoAsid;			// name the frames given back
+    }
+#endif
+}
+
+
+//----------------------------------------------------------------------
+// AddrSpace::HandlePageFault
+//      The page at "virtAddr" is not in memory: read it from the file
+//      it maps, or back from the swap space, or give it a zero-filled
+//      frame if it was never touched.
+//
+//      Return FALSE if the address is outside the address space, or in
+//      the free part of the mapping area between the heap and the
+//      stacks, or if no frame can be found.
+//
+//      Getting a frame and reading a mapped page wait for the disk: the
+//      page is busy meanwhile, the other threads faulting on it wait
+//      instead of giving it a second frame.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::HandlePageFault (int virtAddr)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    TranslationEntry *entry;
+    int frame;
+
+    if (vpn >= numPages)
+	return FALSE;
+    while (PageEntry (vpn) != NULL && Info (vpn)->busy)
+	WaitPage ();
+    if (vpn >= (unsigned) divRoundUp (brk, PageSize) && vpn < mapAreaEnd
+	&& (PageEntry (vpn) == NULL || Info (vpn)->mapping == NULL))
+      {
+	  DEBUG ('a', "Virtual page %d is neither heap nor mapped\n", vpn);
+	  return FALSE;
+      }
+    entry = NewPageEntry (vpn);
+    if (entry->valid)
+      {
+#ifdef USE_TLB
+	  if (HugePageEntry (vpn) != NULL)
+	      entry = HugePageEntry (vpn);
+	  tlbManager->Refill (asid, entry);	// only missing from the TLB
+#endif
+	  return TRUE;		// or brought in while we waited
+      }
+
+    Info (vpn)->busy = TRUE;
+    if (Info (vpn)->mapping != NULL && MapHugePage (vpn))
+      {
+	  stats->numPageFaults++;
+#ifdef USE_TLB
+	  tlbManager->Refill (asid, HugePageEntry (vpn));
+#endif
+	  ReleasePage (vpn);
+	  return TRUE;
+      }
+
+    frame = pager->GetFrame(this, vpn, TRUE);
+    if (frame < 0)
+      {
+	  ReleasePage (vpn);
+	  return FALSE;
+      }
+
+    stats->numPageFaults++;
+    if (Info (vpn)->mapping != NULL)
+      {
+	  MappedRegion *region = Info (vpn)->mapping;
+	  int position = (vpn - region->firstPage) * PageSize;
+	  int numBytes = region->length - position;
+
+	  if (numBytes > PageSize)
+	      numBytes = PageSize;	// the rest of the frame stays zero
+	  DEBUG ('a', "Virtual page %d read from its file in frame %d\n",
+		 vpn, frame);
+	  region->file->ReadAt (&machine->mainMemory[frame * PageSize],
+				numBytes, region->offset + position);
+      }
+    else if (Info (vpn)->swapSlot >= 0)
+      {
+	  // the copy in the swap space stays valid until the page is
+	  // written to again
+	  DEBUG ('a', "Virtual page %d swapped in to frame %d\n", vpn, frame);
+	  pager->ReadSwap (Info (vpn)->swapSlot, frame);
+      }
+    else
+	DEBUG ('a', "Zero-filled virtual page %d in frame %d\n", vpn, frame);
+    entry->physicalPage = frame;
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+    entry->valid = TRUE;
+    pager->SetOwner (frame, this, vpn);
+    ReleasePage (vpn);
+#ifdef USE_TLB
+    tlbManager->Refill (asid, entry);
+#endif
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapHugePage
+//      Page fault on "vpn", in a mapping: if the aligned group of
+//      HugePageFactor pages holding it lies in the mapping and none of
+//      them is in memory, read them all from the file at once, in an
+//      aligned run of frames mapped by a huge page.
+//
+//      Return FALSE, doing nothing, if the group does not qualify or
+//      no such run of frames is free.  The caller made "vpn" busy, the
+//      other pages of the group are made busy while they are read.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::MapHugePage (unsigned int vpn)
+{
+    unsigned int head = vpn - vpn % HugePageFactor, i;
+    MappedRegion *region = Info (vpn)->mapping;
+    TranslationEntry *entry;
+    int base, position, numBytes;
+
+    if (head < region->firstPage
+	|| head + HugePageFactor > region->firstPage + region->numPages)
+	return FALSE;
+    for (i = head; i < head + HugePageFactor; i++)
+	if (PageEntry (i)->valid || (i != vpn && Info (i)->busy))
+	    return FALSE;
+    base = frameProvider->GetHugeFrame (TRUE);
+    if (base < 0)
+	return FALSE;
+    for (i = head; i < head + HugePageFactor; i++)
+	Info (i)->busy = TRUE;
+
+    position = (head - region->firstPage) * PageSize;
+    numBytes = region->length - position;
+    if (numBytes > HugePageFactor * PageSize)
+	numBytes = HugePageFactor * PageSize;
+    DEBUG ('a', "Virtual pages %d-%d read from their file in frames %d-%d\n",
+	   head, head + HugePageFactor - 1, base, base + HugePageFactor - 1);
+    region->file->ReadAt (&machine->mainMemory[base * PageSize], numBytes,
+			  region->offset + position);
+    for (i = 0; i < HugePageFactor; i++)
+      {
+	  entry = PageEntry (head + i);
+	  entry->physicalPage = base + i;
+	  entry->use = FALSE;
+	  entry->dirty = FALSE;
+	  entry->valid = TRUE;
+	  pager->SetOwner (base + i, this, head + i);
+      }
+    PageEntry (head)->huge = TRUE;
+    for (i = head; i < head + HugePageFactor; i++)
+	if (i != vpn)
+	    ReleasePage (i);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::HandleReadOnlyFault
+//      A write hit a read-only page at "virtAddr".  If the page is
+//      copy-on-write, give this address space its own copy of the frame
+//      (or just take the frame back if nobody else maps it anymore).
+//
+//      Return FALSE if the write is really illegal, or if there is no
+//      free frame left for the copy.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::HandleReadOnlyFault (int virtAddr)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    TranslationEntry *entry;
+    int newFrame;
+
+    entry = PageEntry (vpn);
+    if (entry == NULL || !entry->valid || !Info (vpn)->copyOnWrite)
+	return FALSE;
+    SplitHugePage (vpn);
+
+    if (frameProvider->FrameRefCount(entry->physicalPage) > 1)
+      {
+	  newFrame = pager->GetFrame(this, vpn, TRUE);
+	  if (newFrame < 0)
+	      return FALSE;
+	  DEBUG ('a', "Copy-on-write of virtual page %d, frame %d -> %d\n",
+		 vpn, entry->physicalPage, newFrame);
+	  bcopy (&machine->mainMemory[entry->physicalPage * PageSize],
+		 &machine->mainMemory[newFrame * PageSize], PageSize);
+	  pager->Disown(entry->physicalPage, this);
+	  frameProvider->ReleaseFrame(entry->physicalPage);
+	  entry->physicalPage = newFrame;
+      }
+    pager->SetOwner (entry->physicalPage, this, vpn);
+    entry->readOnly = FALSE;
+    Info (vpn)->copyOnWrite = FALSE;
+#ifdef USE_TLB
+    tlbManager->Invalidate (asid, vpn);
+#endif
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageOut
+//      Give back the frame of virtual page "vpn" (see Pager::GetFrame).
+//      The page is written to the swap space, or to the file it maps,
+//      unless the copy it was read from is still up to date.
+//
+//      Writing to the file waits for the disk: the page is unmapped
+//      first, so that it is neither modified nor moved meanwhile, and is
+//      busy until written.
+//
+//      Return FALSE if the swap space is full.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::PageOut (unsigned int vpn)
+{
+    TranslationEntry *entry = PageEntry (vpn);
+    PageInfo *info = Info (vpn);
+
+    ASSERT (entry != NULL && entry->valid);
+    SplitHugePage (vpn);
+#ifdef USE_TLB
+    tlbManager->Invalidate (asid, vpn);	// brings the dirty bit back
+#endif
+    if (info->mapping == NULL && (info->swapSlot < 0 || entry->dirty))
+      {
+	  if (info->swapSlot < 0)
+	      info->swapSlot = pager->AllocSwapSlot ();
+	  if (info->swapSlot < 0)
+	      return FALSE;
+	  if (entry->dirty)
+	      stats->numDirtyWriteBacks++;
+	  pager->WriteSwap (info->swapSlot, entry->physicalPage);
+      }
+
+    DEBUG ('a', "Virtual page %d paged out of frame %d\n", vpn,
+	   entry->physicalPage);
+    entry->valid = FALSE;
+    pager->Disown (entry->physicalPage, this);
+    if (info->mapping != NULL && entry->dirty)
+      {
+	  info->busy = TRUE;
+	  WriteBackMappedPage (vpn);
+	  ReleasePage (vpn);
+      }
+    frameProvider->ReleaseFrame (entry->physicalPage);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MovePage
+//      Copy virtual page "vpn" to "frame" and map it there instead.
+//      The caller (Pager::Migrate) frees the old frame.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::MovePage (unsigned int vpn, unsigned int frame)
+{
+    TranslationEntry *entry = PageEntry (vpn);
+
+    ASSERT (entry != NULL && entry->valid && !entry->huge);
+#ifdef USE_TLB
+    tlbManager->Invalidate (asid, vpn);	// the TLB copy has the old frame
+#endif
+    bcopy (&machine->mainMemory[entry->physicalPage * PageSize],
+	   &machine->mainMemory[frame * PageSize], PageSize);
+    entry->physicalPage = frame;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Mmap
+//      Map "length" bytes of "file", from "offset", at the top of the
+//      free part of the mapping area, above the heap.  The pages are read from the file
+//      on their first access, and written back to it when they are
+//      evicted or unmapped, if they were modified.
+//
+//      The mappings of a process are not inherited by a forked child.
+//      Return the address of the mapping, or -1 if the part of the file
+//      asked for does not exist, or if there is no room left.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Mmap (OpenFile *file, int offset, int length)
+{
+    int mapPages, first, vpn, heapEnd;
+    TranslationEntry *entry;
+    MappedRegion *region;
+
+    if (offset < 0 || length <= 0 || offset + length > file->Length ())
+	return -1;
+    mapPages = divRoundUp (length, PageSize);
+
+    // look for "mapPages" unused pages, from the top of the area
+    heapEnd = divRoundUp (brk, PageSize);
+    for (first = mapAreaEnd; first - mapPages >= heapEnd;
+	 first = vpn)		// else try below the page in use
+      {
+	  for (vpn = first - 1; vpn >= first - mapPages; vpn--)
+	    {
+		entry = PageEntry (vpn);
+		if (entry != NULL && (entry->valid || Info (vpn)->swapSlot >= 0
+				      || Info (vpn)->mapping != NULL
+				      || Info (vpn)->busy))
+		    break;
+	    }
+	  if (vpn < first - mapPages)
+	      break;		// found
+      }
+    if (first - mapPages < heapEnd)
+	return -1;
+    first -= mapPages;
+
+    region = new MappedRegion;
+    region->firstPage = first;
+    region->numPages = mapPages;
+    region->file = file;
+    region->offset = offset;
+    region->length = length;
+    region->next = mappings;
+    mappings = region;
+    for (vpn = first; vpn < first + mapPages; vpn++)
+      {
+	  NewPageEntry (vpn);
+	  Info (vpn)->mapping = region;
+      }
+
+    DEBUG ('a', "Mapped %d bytes at offset %d at page %d\n", length, offset,
+	   first);
+    return first * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Munmap
+//      Remove the mapping at "addr", writing its modified pages back.
+//      As in PageOut, each page is unmapped before it is written, and
+//      the pages busy in another thread are waited for.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Munmap (int addr)
+{
+    MappedRegion **link, *region;
+    TranslationEntry *entry;
+    unsigned int vpn;
+
+    for (link = &mappings; *link != NULL; link = &(*link)->next)
+	if ((*link)->firstPage * PageSize == (unsigned) addr)
+	    break;
+    region = *link;
+    if (region == NULL)
+	return -1;
+    *link = region->next;	// not to be unmapped twice
+
+    for (vpn = region->firstPage; vpn < region->firstPage + region->numPages;
+	 vpn++)
+      {
+	  while (Info (vpn)->busy)
+	      WaitPage ();
+	  SplitHugePage (vpn);
+	  entry = PageEntry (vpn);
+	  if (entry->valid)
+	    {
+#ifdef USE_TLB
+		tlbManager->Invalidate (asid, vpn);	// brings the dirty bit back
+#endif
+		entry->valid = FALSE;
+		pager->Disown (entry->physicalPage, this);
+		if (entry->dirty)
+		  {
+		      Info (vpn)->busy = TRUE;
+		      WriteBackMappedPage (vpn);
+		      ReleasePage (vpn);
+		  }
+		frameProvider->ReleaseFrame (entry->physicalPage);
+	    }
+	  Info (vpn)->mapping = NULL;
+      }
+    delete region;
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Sbrk
+//      Grow or shrink the heap.  The pages it gains are zero-filled on
+//      their first access, the frames and swap slots of the pages it
+//      loses are freed.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Sbrk (int increment)
+{
+    unsigned int oldBrk = brk, newBrk = brk + increment;
+    unsigned int vpn, oldEnd, newEnd;
+    TranslationEntry *entry;
+
+    if ((int) newBrk < (int) (mapAreaFirst * PageSize)
+	|| newBrk > mapAreaEnd * PageSize)
+	return -1;
+    oldEnd = divRoundUp (oldBrk, PageSize);
+    newEnd = divRoundUp (newBrk, PageSize);
+
+    for (vpn = oldEnd; vpn < newEnd; vpn++)
+      {
+	  entry = PageEntry (vpn);
+	  if (entry != NULL && Info (vpn)->mapping != NULL)
+	      return -1;
+      }
+    for (vpn = newEnd; vpn < oldEnd; vpn++)
+      {
+	  entry = PageEntry (vpn);
+	  if (entry == NULL)
+	      continue;
+	  while (Info (vpn)->busy)	// being faulted in
+	      WaitPage ();
+	  if (entry->valid)
+	    {
+#ifdef USE_TLB
+		tlbManager->Invalidate (asid, vpn);
+#endif
+		entry->valid = FALSE;
+		pager->Disown (entry->physicalPage, this);
+		frameProvider->ReleaseFrame (entry->physicalPage);
+	    }
+	  if (Info (vpn)->swapSlot >= 0)
+	      pager->FreeSwapSlot (Info (vpn)->swapSlot);
+	  entry->readOnly = FALSE;
+	  InitPageInfo (Info (vpn));
+      }
+
+    DEBUG ('a', "Heap end moved from 0x%x to 0x%x\n", oldBrk, newBrk);
+    brk = newBrk;
+    return oldBrk;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WaitPage, AddrSpace::ReleasePage
+//      A page is busy while a thread waits for the disk on its behalf,
+//      with the page not mapped.  The threads needing it wait for any
+//      busy page to be released, then look at theirs again.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::WaitPage ()
+{
+    pageWaiters++;
+    pageReleased->P ();
+}
+
+void
+AddrSpace::ReleasePage (unsigned int vpn)
+{
+    Info (vpn)->busy = FALSE;
+    for (; pageWaiters > 0; pageWaiters--)
+	pageReleased->V ();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WriteBackMappedPage
+//      Write the modified page "vpn" to the file it maps.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::WriteBackMappedPage (unsigned int vpn)
+{
+    TranslationEntry *entry = PageEntry (vpn);
+    MappedRegion *region = Info (vpn)->mapping;
+    int position = (vpn - region->firstPage) * PageSize;
+    int numBytes = region->length - position;
+
+    if (numBytes > PageSize)
+	numBytes = PageSize;
+    DEBUG ('a', "Virtual page %d written back to its file\n", vpn);
+    region->file->WriteAt (&machine->mainMemory[entry->physicalPage
+						 * PageSize],
+			   numBytes, region->offset + position);
+    entry->dirty = FALSE;
+    stats->numMappedWriteBacks++;	// not a page out, the swap
+					// space is not involved
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddUserThread
+//      Give a new user thread a tid and a free stack slot, and record
+//      it in the list of threads of this address space.
+//      Return NULL if every stack slot is in use.
+//----------------------------------------------------------------------
+
+UserThreadEntry *
+AddrSpace::AddUserThread ()
+{
+    int slot = stackSlots->Find();
+    if (slot < 0)
+        return NULL;
+
+    UserThreadEntry *entry = new UserThreadEntry;
+    entry->tid = ++tidcounter;
+    entry->stackSlot = slot;
+    entry->exitStatus = 0;
+    entry->finished = FALSE;
+    entry->detached = FALSE;
+    entry->numWaiters = 0;
+    entry->joinSem = new Semaphore("joinSem", 0);
+    entry->next = userThreads;
+    userThreads = entry;
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindUserThread
+//      Return the entry of thread "tid", or NULL if it does not exist
+//      anymore (or never did).
+//----------------------------------------------------------------------
+
+UserThreadEntry *
+AddrSpace::FindUserThread (int tid)
+{
+    UserThreadEntry *entry;
+
+    for (entry = userThreads; entry != NULL; entry = entry->next)
+        if (entry->tid == tid)
+            return entry;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RemoveUserThread
+//      Forget about a thread, releasing its stack slot if it did not
+//      already do it on exit.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::RemoveUserThread (UserThreadEntry *entry)
+{
+    UserThreadEntry **link;
+
+    for (link = &userThreads; *link != NULL; link = &(*link)->next)
+        if (*link == entry) {
+            *link = entry->next;
+            break;
+        }
+    ReleaseStackSlot(entry);
+    delete entry->joinSem;
+    delete entry;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReleaseStackSlot
+//      The thread does not run user code anymore, another thread can
+//      take its stack slot.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ReleaseStackSlot (UserThreadEntry *entry)
+{
+    if (entry->stackSlot >= 0) {
+        stackSlots->Clear(entry->stackSlot);
+        entry->stackSlot = -1;
     }
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::UserThreadStackTop
+//      Initial stack pointer of a thread running on "stackSlot".
+//----------------------------------------------------------------------
+
+int
+AddrSpace::UserThreadStackTop (int stackSlot)
+{
+    return numPages * PageSize - stackSlot * ThreadStackSize - 8;
+}
 
 #ifndef FILESYS_STUB
 //  Look up file name in openFilesTable, and return the index in the table
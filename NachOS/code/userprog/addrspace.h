@@ -16,15 +16,31 @@
 #include "copyright.h"
 #include "filesys.h"
 #include "synch.h"
+#include "bitmap.h"
 
 
 #define UserStackSize		512	// increase this as necessary!
 #define ThreadStackSize     64
-#define MaxNumThreads       1024 //(512 : 64 )
+#define NumStackSlots       (UserStackSize / ThreadStackSize - 1)
+                                // slot 0 is the stack of the main thread
+#define SparseAddrSpaceSize (1 << 20)	// with two-level page tables, the
+				// stacks are at the top of this space
+#define MapAreaSize		(64 * 1024)	// room for the heap (Sbrk,
+				// growing up from the uninitialized data)
+				// and Mmap (growing down from the stacks)
 
 
 
 class Semaphore;
+class SynchConsole;
+struct noffHeader;
+
+// Virtual pages of a program that only hold code (see execcache.h)
+extern void SharedCodePages (struct noffHeader *noffH,
+			     unsigned int *firstPage, unsigned int *numPages);
+// Virtual pages of a program loaded from the file, the others are
+// zero-filled on demand
+extern unsigned int ImagePages (struct noffHeader *noffH);
 
 #ifndef FILESYS_STUB
 #define CompleteFileNameMaxLen 250
@@ -37,14 +53,45 @@ class ProcessOpenFilesTableEntry {
 };
 #endif // NOT FILESYS_STUB
 
-typedef struct node
-{
-	int threadID;
-  int active;
-  int child[10];
-  node *next;
-  Semaphore *sem;
-}threadList_t;
+// A part of a file mapped by Mmap
+class MappedRegion {
+  public:
+    unsigned int firstPage;	// virtual pages it occupies
+    unsigned int numPages;
+    OpenFile *file;
+    int offset;			// first byte of the file mapped
+    int length;			// number of bytes mapped
+    MappedRegion *next;
+};
+
+// Kernel bookkeeping of a virtual page, beside its translation
+class PageInfo {
+  public:
+    bool copyOnWrite;		// page is read-only until its first write,
+				// its frame is shared with a forked
+				// address space
+    int swapSlot;		// copy of the page in the swap space,
+				// -1 if there is none
+    MappedRegion *mapping;	// file the page is read from and written
+				// back to instead, NULL if none
+    bool busy;			// a thread is giving it a frame or
+				// writing it back, see WaitPage
+};
+
+// Bookkeeping for one user thread of an address space.  An entry only
+// lives while the thread runs, or, once it has finished, until its exit
+// status has been collected by UserThreadJoin (never, if it is detached).
+class UserThreadEntry {
+  public:
+    int tid;
+    int stackSlot;		// slot of the user stack region it runs on
+    int exitStatus;		// value given to UserThreadExit
+    bool finished;
+    bool detached;		// nobody will join: drop the entry on exit
+    int numWaiters;		// threads blocked in UserThreadJoin on it
+    Semaphore *joinSem;		// V'ed once per waiter when the thread exits
+    UserThreadEntry *next;
+};
 
 
 class AddrSpace
@@ -53,6 +100,8 @@ class AddrSpace
     AddrSpace (OpenFile * executable);	// Create an address space,
     // initializing it with the program
     // stored in the file "executable"
+    AddrSpace (AddrSpace *parent, int stackSlot);
+    				// Copy-on-write image of "parent", for Fork
     ~AddrSpace ();		// De-allocate an address space
 
     void InitRegisters ();	// Initialize user-level CPU registers,
@@ -62,7 +111,33 @@ class AddrSpace
     void RestoreState ();	// info on a context switch 
 
     unsigned int GetNumPages (); // Get the number of pgs 
+    TranslationEntry *PageEntry (unsigned int vpn); // NULL if nothing is
+				// mapped there in a two-level page table
+    TranslationEntry *HugePageEntry (unsigned int vpn); // entry of the
+				// huge page holding "vpn", NULL if none
     void FreeFrames(); //Deallcate Memory
+    bool HandlePageFault (int virtAddr); // Zero-fill on demand
+    bool HandleReadOnlyFault (int virtAddr); // Copy-on-write
+    bool PageOut (unsigned int vpn); // Evict the page to the swap space
+    void MovePage (unsigned int vpn, unsigned int frame); // Copy the page
+				// to another frame, for the compaction
+
+    // Map "length" bytes of "file" from "offset", return the address of
+    // the mapping or -1.  Munmap returns 0, or -1 if nothing is mapped
+    // at "addr".
+    int Mmap (OpenFile *file, int offset, int length);
+    int Munmap (int addr);
+
+    // Move the end of the heap by "increment" bytes, return the old end
+    // or -1 if it would run into a mapping or out of the area
+    int Sbrk (int increment);
+
+    // User thread bookkeeping, callers must hold lock_threads
+    UserThreadEntry *AddUserThread ();	// NULL if no stack slot is free
+    UserThreadEntry *FindUserThread (int tid);
+    void RemoveUserThread (UserThreadEntry *entry);
+    void ReleaseStackSlot (UserThreadEntry *entry);
+    int UserThreadStackTop (int stackSlot);
 
     #ifndef FILESYS_STUB
     int AddToOpenFilesTable(const char *name, OpenFile *openFile);
@@ -70,22 +145,58 @@ class AddrSpace
     #endif // NOT FILESYS_STUB
 
   private:
-      TranslationEntry * pageTable;	// Assume linear page table translation
-    // for now!
+      TranslationEntry * pageTable;	// Linear page table translation,
+    // or NULL when the address space uses
+    TranslationEntry **pageDirectory;	// a two-level page table, whose
+    // second-level tables are only allocated for the parts of the address
+    // space that are used (see SecondLevelSize in machine.h)
     unsigned int numPages;	// Number of pages in the virtual 
     // address space
+    PageInfo *pageInfo;		// kernel bookkeeping of each page
+    PageInfo **pageInfoDir;	// same, with a two-level page table
+
+    void AllocPageTable (bool twoLevel); // every page unmapped
+    TranslationEntry *NewPageEntry (unsigned int vpn); // allocate
+				// its second-level table if needed
+    PageInfo *Info (unsigned int vpn);	// the page must have a translation
+    void SetPageOwners ();	// let the pager evict the loaded pages
+
+    // Huge pages (see HugePageFactor in machine.h)
+    void PromoteHugePages (unsigned int first, unsigned int end);
+    void SplitHugePage (unsigned int vpn); // back to one entry per page
+    bool MapHugePage (unsigned int vpn); // fault in a group of a mapping
+
+    unsigned int mapAreaFirst;	// virtual pages the heap and Mmap use
+    unsigned int mapAreaEnd;
+    unsigned int brk;		// end of the heap
+    MappedRegion *mappings;
+    void WriteBackMappedPage (unsigned int vpn);
+
+    // Pages waiting for the disk, while not mapped
+    int pageWaiters;		// threads blocked in WaitPage
+    Semaphore *pageReleased;
+    void WaitPage ();		// until a busy page is released
+    void ReleasePage (unsigned int vpn);
+    void InitProcessState ();	// thread, semaphore and files bookkeeping
+
+#ifdef USE_TLB
+    unsigned int asid;		// tags the TLB entries of this address space
+#endif
+
+    UserThreadEntry *userThreads; // live and not yet joined threads
+    BitMap *stackSlots;		// user stack slots in use
 
   public:
     int tidcounter;  //count the number of threads created
     int livethreads; //count the number of live threads
-    Semaphore *lock_tidcounter; //lock to protect tidcounter
-    Semaphore *lock_livethreads; //lock to protect livethreads
-    Semaphore *createdThreads[MaxNumThreads]; //Semaphores to keep track of created threads
+    bool exiting; //the main thread waits in Exit for the others
+    bool killed; //the process ends, each thread at its next trap
+    Semaphore *lock_threads; //lock to protect the thread bookkeeping
+    Semaphore *allThreadsDone; //V'ed by the last thread if exiting
     Semaphore *userSemaphores[100];
     int userSemCounter;
-    threadList_t *threads;
-    int activeThreads[MaxNumThreads];
     int pro; //the proccess that this addrspace belongs
+    SynchConsole *console; //terminal of the process, see ForkExecTerm
     #ifndef FILESYS_STUB
     ProcessOpenFilesTableEntry *openFilesTable;
     #endif // NOT FILESYS_STUB
@@ -0,0 +1,478 @@
+// admission.cc
+//      Routines to admit, suspend and resume user processes depending
+//      on the memory they use.
+
+#include "copyright.h"
+#include "system.h"
+#include "admission.h"
+#include "addrspace.h"
+
+static void
+TimeoutHelper (int arg)
+{
+    AdmissionControl *self = (AdmissionControl *) arg;
+
+    self->Timeout ();
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::AdmissionControl
+//      Nothing running, nothing waiting.
+//----------------------------------------------------------------------
+
+AdmissionControl::AdmissionControl ()
+{
+    processes = NULL;
+    queue = NULL;
+    queueTail = NULL;
+    pendingPages = 0;
+    thrashing = FALSE;
+    windowStart = 0;
+    windowPageIns = 0;
+    lock = new Semaphore ("lock_admission", 1);
+    timerPending = FALSE;
+    check = new Semaphore ("admission check", 0);
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::~AdmissionControl
+//----------------------------------------------------------------------
+
+AdmissionControl::~AdmissionControl ()
+{
+    AdmittedProcess *process;
+
+    while (processes != NULL)
+      {
+	  process = processes;
+	  processes = process->next;
+	  delete process->resumed;
+	  delete process;
+      }
+    delete lock;
+    delete check;
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::StartChecker
+//      Fork the kernel thread that looks at the waiting processes
+//      again each time the timer expires.
+//----------------------------------------------------------------------
+
+void
+AdmissionControl::StartChecker ()
+{
+    Thread *t = new Thread ("admission");
+
+    t->Fork (CheckerHelper, (int) this);
+}
+
+void
+AdmissionControl::CheckerHelper (int arg)
+{
+    AdmissionControl *self = (AdmissionControl *) arg;
+
+    self->Checker ();
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::Admit
+//      Block the caller until a process needing "numPages" frames fits
+//      in memory.  The processes waiting before it, or suspended, go
+//      first.
+//----------------------------------------------------------------------
+
+void
+AdmissionControl::Admit (unsigned int numPages)
+{
+    AdmissionRequest *request;
+    AdmittedProcess *process;
+    bool suspended = FALSE;
+
+    lock->P ();
+    for (process = processes; process != NULL; process = process->next)
+	if (process->suspended)
+	    suspended = TRUE;
+    if (queue == NULL && !suspended && Fits (numPages))
+      {
+	  pendingPages += numPages;
+	  lock->V ();
+	  return;
+      }
+
+    DEBUG ('a', "Process needing %d frames queued\n", numPages);
+    request = new AdmissionRequest;
+    request->numPages = numPages;
+    request->admitted = new Semaphore ("admitted", 0);
+    request->next = NULL;
+    if (queue == NULL)
+	queue = request;
+    else
+	queueTail->next = request;
+    queueTail = request;
+    StartTimer ();
+    lock->V ();
+
+    request->admitted->P ();	// Schedule counted it in pendingPages
+    delete request->admitted;
+    delete request;
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::Started
+//      The process admitted for "numPages" frames is loaded in "space".
+//----------------------------------------------------------------------
+
+void
+AdmissionControl::Started (AddrSpace *space, unsigned int numPages)
+{
+    AdmittedProcess *process = new AdmittedProcess;
+
+    process->space = space;
+    process->suspended = FALSE;
+    process->workingSet = 0;
+    process->numBlocked = 0;
+    process->numFaulting = 0;
+    process->resumed = new Semaphore ("resumed", 0);
+
+    lock->P ();
+    ASSERT (pendingPages >= numPages);
+    pendingPages -= numPages;
+    process->next = processes;
+    processes = process;
+    lock->V ();
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::Exited
+//      The frames of "space" are free, resume or admit whatever fits
+//      now.  The memory pressure changed, so thrashing is measured
+//      again from scratch.
+//----------------------------------------------------------------------
+
+void
+AdmissionControl::Exited (AddrSpace *space)
+{
+    AdmittedProcess **link, *process;
+
+    lock->P ();
+    for (link = &processes; *link != NULL; link = &(*link)->next)
+	if ((*link)->space == space)
+	  {
+	      process = *link;
+	      *link = process->next;
+	      delete process->resumed;
+	      delete process;
+	      break;
+	  }
+
+    thrashing = FALSE;
+    windowStart = stats->totalTicks;
+    windowPageIns = stats->numPageIns;
+    Schedule ();
+    lock->V ();
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::PageFault
+//      Called on every page fault of a thread of "space".  At the end
+//      of each window of ThrashingWindow ticks, check whether more than
+//      half of it was spent paging.
+//
+//      If "space" is suspended, the thread waits until it is resumed.
+//      Until PageFaultDone, the thread is in the pager: its process
+//      can make progress.
+//----------------------------------------------------------------------
+
+void
+AdmissionControl::PageFault (AddrSpace *space)
+{
+    AdmittedProcess *process;
+
+    lock->P ();
+    if (Measure ())
+      {
+	  if (thrashing)
+	      Suspend ();
+	  else
+	      Schedule ();
+      }
+
+    process = Find (space);
+    if (process != NULL)
+	process->numFaulting++;
+    if (process == NULL || !process->suspended)
+      {
+	  lock->V ();
+	  return;
+      }
+    process->numBlocked++;
+    lock->V ();
+    process->resumed->P ();
+}
+
+void
+AdmissionControl::PageFaultDone (AddrSpace *space)
+{
+    AdmittedProcess *process;
+
+    lock->P ();
+    process = Find (space);
+    if (process != NULL)
+	process->numFaulting--;
+    lock->V ();
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::Timeout
+//      Interrupt handler of the timer: wake the checker up.
+//----------------------------------------------------------------------
+
+void
+AdmissionControl::Timeout ()
+{
+    timerPending = FALSE;
+    check->V ();
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::Find
+//      The process running in "space", NULL if none.  The caller holds
+//      the lock.
+//----------------------------------------------------------------------
+
+AdmittedProcess *
+AdmissionControl::Find (AddrSpace *space)
+{
+    AdmittedProcess *process;
+
+    for (process = processes; process != NULL; process = process->next)
+	if (process->space == space)
+	    break;
+    return process;
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::Measure
+//      At the end of each window of ThrashingWindow ticks, check whether
+//      more than half of it was spent paging, and start the next one.
+//      Return FALSE if the window is not over.  The caller holds the
+//      lock.
+//----------------------------------------------------------------------
+
+bool
+AdmissionControl::Measure ()
+{
+    long long elapsed = stats->totalTicks - windowStart;
+
+    if (elapsed < ThrashingWindow)
+	return FALSE;
+    thrashing = 2LL * (stats->numPageIns - windowPageIns) * SwapTime
+	> elapsed;
+    windowStart = stats->totalTicks;
+    windowPageIns = stats->numPageIns;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::LoadPages
+//      Frames used by the processes running or about to.  A process
+//      resumed has not got its pages back yet, count the ones it had.
+//      The caller holds the lock.
+//----------------------------------------------------------------------
+
+unsigned int
+AdmissionControl::LoadPages ()
+{
+    AdmittedProcess *process;
+    unsigned int numPages = pendingPages, resident;
+
+    for (process = processes; process != NULL; process = process->next)
+	if (!process->suspended)
+	  {
+	      resident = pager->ResidentFrames (process->space);
+	      if (resident < process->workingSet)
+		  resident = process->workingSet;
+	      numPages += resident;
+	  }
+    return numPages;
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::CanRun
+//      Can "process" make progress?  It can if one of its threads is
+//      running, ready to run or in the pager.  Its threads waiting for
+//      something else (a child, the console...) may wait for long.
+//----------------------------------------------------------------------
+
+bool
+AdmissionControl::CanRun (AdmittedProcess *process)
+{
+    IntStatus oldLevel;
+    int numReady;
+
+    if (process->numFaulting > 0 || currentThread->space == process->space)
+	return TRUE;
+    oldLevel = interrupt->SetLevel (IntOff);
+    numReady = scheduler->NumReadyThreads (process->space);
+    (void) interrupt->SetLevel (oldLevel);
+    return numReady > 0;
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::NumRunnable
+//      Number of processes not suspended that can make progress.  The
+//      caller holds the lock.
+//----------------------------------------------------------------------
+
+int
+AdmissionControl::NumRunnable ()
+{
+    AdmittedProcess *process;
+    int n = 0;
+
+    for (process = processes; process != NULL; process = process->next)
+	if (!process->suspended && CanRun (process))
+	    n++;
+    return n;
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::Fits
+//      Can a process using "numPages" frames run now?  It always can
+//      if nothing else runs.  The caller holds the lock.
+//----------------------------------------------------------------------
+
+bool
+AdmissionControl::Fits (unsigned int numPages)
+{
+    unsigned int load = LoadPages ();
+
+    if (load == 0)
+	return TRUE;
+    return !thrashing && load + numPages <= (unsigned) NumPhysPages;
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::Suspend
+//      Suspend the process admitted last among those that can make
+//      progress, unless it is the only one, and swap its pages out.
+//      The caller holds the lock.
+//----------------------------------------------------------------------
+
+void
+AdmissionControl::Suspend ()
+{
+    AdmittedProcess *process, *victim = NULL;
+    int numRunnable = 0;
+
+    for (process = processes; process != NULL; process = process->next)
+	if (!process->suspended && CanRun (process))
+	  {
+	      if (victim == NULL)
+		  victim = process;
+	      numRunnable++;
+	  }
+    if (numRunnable < 2)
+	return;
+
+    victim->suspended = TRUE;
+    victim->workingSet = pager->ResidentFrames (victim->space);
+    DEBUG ('a', "Thrashing: process %d suspended, %d frames swapped out\n",
+	   victim->space->pro, victim->workingSet);
+    pager->SwapOut (victim->space);
+    stats->numSuspensions++;
+    StartTimer ();
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::Schedule
+//      Resume the suspended processes, oldest first, then admit the
+//      queued ones, for as long as they fit.  If no process can make
+//      progress, one of them goes even if it does not fit: waiting
+//      would not free any frame.  The caller holds the lock.
+//----------------------------------------------------------------------
+
+void
+AdmissionControl::Schedule ()
+{
+    AdmittedProcess *process, *oldest;
+    AdmissionRequest *request;
+
+    for (;;)
+      {
+	  oldest = NULL;
+	  for (process = processes; process != NULL; process = process->next)
+	      if (process->suspended)
+		  oldest = process;
+	  if (oldest == NULL)
+	      break;
+	  if (!Fits (oldest->workingSet) && NumRunnable () > 0)
+	      return;
+	  DEBUG ('a', "Process %d resumed\n", oldest->space->pro);
+	  oldest->suspended = FALSE;
+	  for (; oldest->numBlocked > 0; oldest->numBlocked--)
+	      oldest->resumed->V ();
+      }
+
+    while (queue != NULL
+	   && (Fits (queue->numPages)
+	       || (NumRunnable () == 0 && pendingPages == 0)))
+      {
+	  request = queue;
+	  queue = request->next;
+	  pendingPages += request->numPages;
+	  request->admitted->V ();
+      }
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::StartTimer
+//      Have the checker run in ThrashingWindow ticks, if it is not
+//      already due to.  The caller holds the lock.
+//----------------------------------------------------------------------
+
+void
+AdmissionControl::StartTimer ()
+{
+    IntStatus oldLevel = interrupt->SetLevel (IntOff);
+
+    // not a TimerInt: an idle machine does not wait for those, and the
+    // check matters most when nothing else happens
+    if (!timerPending)
+      {
+	  timerPending = TRUE;
+	  interrupt->Schedule (TimeoutHelper, (int) this, ThrashingWindow,
+			       NetworkTimerInt);
+      }
+    (void) interrupt->SetLevel (oldLevel);
+}
+
+//----------------------------------------------------------------------
+// AdmissionControl::Checker
+//      Each time the timer expires, measure the thrashing again and
+//      resume or admit the processes that can go.  The timer is started
+//      again as long as processes wait.
+//----------------------------------------------------------------------
+
+void
+AdmissionControl::Checker ()
+{
+    AdmittedProcess *process;
+    bool waiting;
+
+    for (;;)
+      {
+	  check->P ();
+	  lock->P ();
+	  Measure ();
+	  Schedule ();
+	  waiting = queue != NULL;
+	  for (process = processes; process != NULL; process = process->next)
+	      if (process->suspended)
+		  waiting = TRUE;
+	  if (waiting)
+	      StartTimer ();
+	  lock->V ();
+      }
+}
@@ -0,0 +1,104 @@
+// admission.h
+//      Admission control of user processes.
+//
+//      A process started by ForkExec waits in a queue until the pages
+//      the running processes use, plus the ones it needs to start, fit
+//      in physical memory.  The pages a process uses are estimated by
+//      the frames it owns (see Pager), a rough measure of its working
+//      set.
+//
+//      When the machine spends more than half of its time paging, it
+//      is thrashing: the process admitted last is suspended, and its
+//      pages swapped out, so that the others can make progress.  It is
+//      resumed, before any new process is admitted, once its pages fit
+//      again.
+//
+//      Only the processes that can make progress count: those with a
+//      thread running, ready to run or in the pager.  A process whose
+//      threads are all blocked elsewhere (waiting for a child, say) is
+//      not suspended, and does not keep the others suspended or queued:
+//      when no process can make progress, the oldest suspended one is
+//      resumed, or else the first queued one is admitted.  Besides the
+//      page faults, this is checked on a timer while processes wait,
+//      since nothing may fault anymore.
+
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include "copyright.h"
+#include "synch.h"
+
+class AddrSpace;
+
+#define ThrashingWindow 50000	// ticks over which the paging time is
+				// measured, and between two checks of the
+				// waiting processes
+
+class AdmittedProcess {
+  public:
+    AddrSpace *space;
+    bool suspended;
+    unsigned int workingSet;	// frames it owned when it was suspended
+    int numBlocked;		// its threads waiting to be resumed
+    int numFaulting;		// its threads in the pager
+    Semaphore *resumed;
+    AdmittedProcess *next;
+};
+
+class AdmissionRequest {
+  public:
+    unsigned int numPages;	// frames the process needs to start
+    Semaphore *admitted;
+    AdmissionRequest *next;
+};
+
+class AdmissionControl {
+  public:
+    AdmissionControl ();
+    ~AdmissionControl ();
+
+    void StartChecker ();	// fork the thread of the timer checks
+
+    // Wait until a process needing "numPages" frames can be started
+    void Admit (unsigned int numPages);
+
+    // The address space of a process is loaded.  "numPages" is the
+    // number of frames given to Admit, 0 if it was not called.
+    void Started (AddrSpace *space, unsigned int numPages);
+    // The process freed its frames
+    void Exited (AddrSpace *space);
+
+    // A thread of "space" page faults: look for thrashing, and block
+    // the thread if its process is suspended.  PageFaultDone is called
+    // once the fault is handled.
+    void PageFault (AddrSpace *space);
+    void PageFaultDone (AddrSpace *space);
+
+    void Timeout ();		// interrupt handler of the check timer
+
+  private:
+    AdmittedProcess *processes;	// most recently admitted first
+    AdmissionRequest *queue;	// first come, first served
+    AdmissionRequest *queueTail;
+    unsigned int pendingPages;	// admitted, not started yet
+    bool thrashing;
+    long long windowStart;	// ticks at the start of the current
+    int windowPageIns;		// window, and page ins so far
+    Semaphore *lock;
+    bool timerPending;
+    Semaphore *check;		// V'ed by the timer
+
+    AdmittedProcess *Find (AddrSpace *space);
+    bool Measure ();		// FALSE if the window is not over
+    unsigned int LoadPages ();	// frames of the running processes
+    bool CanRun (AdmittedProcess *process);
+    int NumRunnable ();		// processes not suspended that can run
+    bool Fits (unsigned int numPages);
+    void Suspend ();
+    void Schedule ();		// resume or admit whatever fits
+    void StartTimer ();		// while processes wait
+    void Checker ();
+    static void CheckerHelper (int arg);
+};
+
+#endif // ADMISSION_H
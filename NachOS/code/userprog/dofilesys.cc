@@ -291,3 +291,32 @@ int do_lseek(int fileDescriptor, int offset){
 
 }
 
+//Map "length" bytes of the file referred by fileDescriptor, from "offset"
+//Return the address of the mapping or -1 in case of error
+int do_Mmap(int fileDescriptor, int offset, int length){
+
+	#ifdef FILESYS_STUB //In case we are in FILESYS_STUB flavor
+	DEBUG('s', "It is not possible to execute 'Mmap' in FILESYS_STUB flavor\n");
+	return -1;
+	#else // FILESYS
+
+	AddrSpace *space = currentThread->space;
+
+	if(fileDescriptor < 0 || fileDescriptor >= MaxOpenFilesInProcess
+	   || !space->openFilesTable[fileDescriptor].inUse)
+		return -1;
+
+	//the mapping keeps using the OpenFile after the descriptor is closed
+	return space->Mmap(space->openFilesTable[fileDescriptor].openFile,
+	                   offset, length);
+
+	#endif // FILESYS
+}
+
+//Return 0 if everything is ok, -1 if nothing is mapped at "addr"
+int do_Munmap(int addr){
+
+	return currentThread->space->Munmap(addr);
+
+}
+
@@ -13,3 +13,5 @@ extern int do_read(int fileDescriptor, int count);
 extern int do_write(int fileDescriptor, int buf, int size);
 extern int do_close(int fileDescriptor);
 extern int do_lseek(int fileDescriptor, int offset);
+extern int do_Mmap(int fileDescriptor, int offset, int length);
+extern int do_Munmap(int addr);
@@ -0,0 +1,458 @@
+// donetwork.cc
+//      Network ports and Select, for the system calls of user programs.
+//
+//      A port takes over a mailbox of the post office: the postal
+//      worker hands it the messages as they arrive (see MailReceiver),
+//      it keeps them in their packet buffers until a thread of its
+//      process receives them.  Messages are copied between the buffers
+//      and user memory a page at a time (Machine::ReadBlock and
+//      WriteBlock), never byte by byte.
+//
+//      Ports need the network; without it, their system calls fail.
+
+#include "copyright.h"
+#include "donetwork.h"
+#include "addrspace.h"
+#include "syscall.h"
+#include "synchqueue.h"
+
+#ifdef NETWORK
+class Port : public MailReceiver {
+  public:
+    Port (MailBoxAddress portBox, int portFlags, AddrSpace *space);
+    ~Port ();
+
+    void Deliver (PacketBuffer *packet);	// from the postal worker
+    PacketBuffer *Get ();	// wait for a message, unless the port is
+				// non-blocking: NULL if there is none
+    bool Ready () { return queue->NumItems () > 0; }
+
+    MailBoxAddress box;
+    int flags;
+    AddrSpace *owner;
+    int numReaders;		// threads waiting in Get
+
+  private:
+    SynchQueue *queue;		// buffers of the messages, in order
+};
+
+static Port *ports[MaxPorts];
+
+//----------------------------------------------------------------------
+// Port::Port
+//      Empty port of "space" on mailbox "portBox", already attached.
+//----------------------------------------------------------------------
+
+Port::Port (MailBoxAddress portBox, int portFlags, AddrSpace *space)
+{
+    box = portBox;
+    flags = portFlags;
+    owner = space;
+    numReaders = 0;
+    queue = new SynchQueue ("port messages", MaxPortQueue);
+}
+
+//----------------------------------------------------------------------
+// Port::~Port
+//      Drop the messages not received.
+//----------------------------------------------------------------------
+
+Port::~Port ()
+{
+    PacketBuffer *packet;
+
+    while ((packet = (PacketBuffer *) queue->TryGet ()) != NULL)
+	packet->Release ();
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// Port::Deliver
+//      Queue the message, unless MaxPortQueue are already waiting: the
+//      network is unreliable anyway, the sender has to cope with it.
+//----------------------------------------------------------------------
+
+void
+Port::Deliver (PacketBuffer *packet)
+{
+    if (!queue->TryPut (packet))
+      {
+	  DEBUG ('n', "Port on box %d full, message dropped\n", box);
+	  packet->Release ();
+	  return;
+      }
+    WakeSelect ();
+}
+
+//----------------------------------------------------------------------
+// Port::Get
+//      Take the first message.
+//----------------------------------------------------------------------
+
+PacketBuffer *
+Port::Get ()
+{
+    PacketBuffer *packet;
+
+    if (flags & PORT_NONBLOCK)
+	return (PacketBuffer *) queue->TryGet ();
+    numReaders++;
+    packet = (PacketBuffer *) queue->Get ();
+    numReaders--;
+    return packet;
+}
+
+//----------------------------------------------------------------------
+// FindPort
+//      The port "port" of the current process, NULL if it has none.
+//----------------------------------------------------------------------
+
+static Port *
+FindPort (int port)
+{
+    if (port < 0 || port >= MaxPorts || ports[port] == NULL
+	|| ports[port]->owner != currentThread->space)
+	return NULL;
+    return ports[port];
+}
+#endif // NETWORK
+
+//----------------------------------------------------------------------
+// do_PortOpen
+//      Open a port on mailbox "box" for the current process.  Return
+//      its number, or -1 if the box is out of range or taken.
+//----------------------------------------------------------------------
+
+int
+do_PortOpen (int box, int flags)
+{
+#ifdef NETWORK
+    int port;
+
+    if (box < 0 || box >= postOffice->NumBoxes ())
+	return -1;
+    for (port = 0; port < MaxPorts; port++)
+	if (ports[port] == NULL)
+	    break;
+    if (port == MaxPorts)
+	return -1;
+
+    ports[port] = new Port (box, flags, currentThread->space);
+    if (!postOffice->Attach (box, ports[port]))
+      {
+	  delete ports[port];
+	  ports[port] = NULL;
+	  return -1;
+      }
+    DEBUG ('n', "Port %d opened on box %d\n", port, box);
+    return port;
+#else
+    DEBUG ('n', "Ports need the network\n");
+    return -1;
+#endif // NETWORK
+}
+
+//----------------------------------------------------------------------
+// do_PortClose
+//      Give the mailbox back to the post office.  Return 0, or -1 if
+//      "port" is not open, or a thread of the process waits on it.
+//----------------------------------------------------------------------
+
+int
+do_PortClose (int port)
+{
+#ifdef NETWORK
+    Port *p = FindPort (port);
+
+    if (p == NULL || p->numReaders > 0)
+	return -1;
+    postOffice->Attach (p->box, NULL);
+    ports[port] = NULL;
+    delete p;
+    return 0;
+#else
+    return -1;
+#endif // NETWORK
+}
+
+//----------------------------------------------------------------------
+// do_PortSend
+//      Send the "size" bytes at "buf" from "port" to the PortAddress at
+//      "to".  The message is copied once, from user memory straight
+//      into the buffer the network sends.  Return "size", or -1.
+//----------------------------------------------------------------------
+
+int
+do_PortSend (int port, int to, int buf, int size)
+{
+#ifdef NETWORK
+    Port *p = FindPort (port);
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    PacketBuffer *packet;
+    int toMachine, toBox;
+
+    if (p == NULL || size < 0 || size > (int) MaxMailSize)
+	return -1;
+    if (!machine->ReadMem (to, 4, &toMachine)
+	|| !machine->ReadMem (to + 4, 4, &toBox))
+	return -1;
+    if (toMachine < 0 || toMachine >= MaxMachines
+	|| toBox < 0 || toBox >= postOffice->NumBoxes ())
+	return -1;
+
+    packet = PacketBuffer::Get ();
+    if (!machine->ReadBlock (buf, MailDataOf (packet), size))
+      {
+	  packet->Release ();
+	  return -1;
+      }
+    pktHdr.to = toMachine;
+    mailHdr.to = toBox;
+    mailHdr.from = p->box;
+    mailHdr.length = size;
+    postOffice->SendBuffer (pktHdr, mailHdr, packet);
+    return size;
+#else
+    return -1;
+#endif // NETWORK
+}
+
+//----------------------------------------------------------------------
+// do_PortReceive
+//      Copy the next message of "port" to "buf", at most "size" bytes,
+//      and its sender to the PortAddress at "from" unless it is NULL.
+//      Return the number of bytes copied, PORT_EMPTY if the port is
+//      non-blocking and has no message, -1 on error.
+//----------------------------------------------------------------------
+
+int
+do_PortReceive (int port, int from, int buf, int size)
+{
+#ifdef NETWORK
+    Port *p = FindPort (port);
+    PacketBuffer *packet;
+    int length;
+
+    if (p == NULL || size < 0)
+	return -1;
+    packet = p->Get ();
+    if (packet == NULL)
+	return PORT_EMPTY;
+
+    length = MailHeaderOf (packet)->length;
+    if (length > size)
+	length = size;
+    if (!machine->WriteBlock (buf, MailDataOf (packet), length)
+	|| (from != 0
+	    && (!machine->WriteMem (from, 4, packet->Header ()->from)
+		|| !machine->WriteMem (from + 4, 4,
+				       MailHeaderOf (packet)->from))))
+	length = -1;
+    packet->Release ();
+    return length;
+#else
+    return -1;
+#endif // NETWORK
+}
+
+//----------------------------------------------------------------------
+// ClosePorts
+//      Close the ports left open by "space", whose threads are done.
+//----------------------------------------------------------------------
+
+void
+ClosePorts (AddrSpace *space)
+{
+#ifdef NETWORK
+    for (int port = 0; port < MaxPorts; port++)
+	if (ports[port] != NULL && ports[port]->owner == space)
+	  {
+	      postOffice->Attach (ports[port]->box, NULL);
+	      delete ports[port];
+	      ports[port] = NULL;
+	  }
+#endif // NETWORK
+}
+
+//----------------------------------------------------------------------
+// Select
+//
+//      A thread waiting in Select is woken by WakeSelect on any event,
+//      checks its entries again, and waits again if none is ready.
+//      Its waiter is freed by the last of Select, WakeSelect and the
+//      timeout interrupt to be done with it.
+//----------------------------------------------------------------------
+
+class SelectWaiter {
+  public:
+    Semaphore *wake;
+    bool inList;		// in selectWaiters
+    bool timerPending;		// the timeout interrupt is scheduled
+    bool expired;
+    bool done;			// Select returned
+};
+
+static List selectWaiters;
+
+static void
+FreeWaiter (SelectWaiter *waiter)
+{
+    if (waiter->done && !waiter->inList && !waiter->timerPending)
+      {
+	  delete waiter->wake;
+	  delete waiter;
+      }
+}
+
+void
+WakeSelect ()
+{
+    IntStatus oldLevel = interrupt->SetLevel (IntOff);
+    SelectWaiter *waiter;
+
+    while ((waiter = (SelectWaiter *) selectWaiters.Remove ()) != NULL)
+      {
+	  waiter->inList = FALSE;
+	  if (waiter->done)
+	      FreeWaiter (waiter);
+	  else
+	      waiter->wake->V ();
+      }
+    (void) interrupt->SetLevel (oldLevel);
+}
+
+static void
+SelectTimeout (int arg)
+{
+    SelectWaiter *waiter = (SelectWaiter *) arg;
+
+    waiter->timerPending = FALSE;
+    waiter->expired = TRUE;
+    if (waiter->done)
+	FreeWaiter (waiter);
+    else
+	waiter->wake->V ();
+}
+
+//----------------------------------------------------------------------
+// EntryReady
+//      Is the entry of kind "kind" and id "id" ready?  -1 if it does not
+//      name anything of the current process.
+//----------------------------------------------------------------------
+
+static int
+EntryReady (int kind, int id)
+{
+    AddrSpace *space = currentThread->space;
+
+    switch (kind)
+      {
+      case SELECT_PORT:
+#ifdef NETWORK
+	  {
+	      Port *p = FindPort (id);
+
+	      if (p == NULL)
+		  return -1;
+	      return p->Ready ();
+	  }
+#else
+	  return -1;
+#endif // NETWORK
+      case SELECT_FILE:
+#ifndef FILESYS_STUB
+	  if (id < 0 || id >= MaxOpenFilesInProcess
+	      || !space->openFilesTable[id].inUse)
+	      return -1;
+	  return 1;		// reading a file never waits
+#else
+	  return -1;
+#endif // NOT FILESYS_STUB
+      case SELECT_CONSOLE:
+	  return space->console->InputReady ();
+      default:
+	  return -1;
+      }
+}
+
+//----------------------------------------------------------------------
+// do_Select
+//      Wait until one of the "numEntries" SelectEntry at "entries" is
+//      ready, or "timeout" ticks passed (-1: no limit, 0: do not wait),
+//      and set their "ready" field.  Return the number of entries
+//      ready, 0 on timeout, -1 if an entry is invalid.
+//----------------------------------------------------------------------
+
+int
+do_Select (int entries, int numEntries, int timeout)
+{
+    int fields[3 * MaxSelectEntries];
+    int ready[MaxSelectEntries];
+    SelectWaiter *waiter = NULL;
+    IntStatus oldLevel;
+    int numReady, i;
+
+    if (numEntries <= 0 || numEntries > MaxSelectEntries)
+	return -1;
+    if (!machine->ReadBlock (entries, (char *) fields,
+			     numEntries * 3 * sizeof (int)))
+	return -1;
+
+    // Interrupts stay off from the check to the wait, so that no event
+    // can come between them unseen
+    oldLevel = interrupt->SetLevel (IntOff);
+    for (;;)
+      {
+	  numReady = 0;
+	  for (i = 0; i < numEntries; i++)
+	    {
+		ready[i] = EntryReady (WordToHost (fields[3 * i]),
+				       WordToHost (fields[3 * i + 1]));
+		if (ready[i] < 0)
+		  {
+		      numReady = -1;
+		      break;
+		  }
+		numReady += ready[i];
+	    }
+	  if (numReady != 0 || timeout == 0
+	      || (waiter != NULL && waiter->expired))
+	      break;
+
+	  if (waiter == NULL)
+	    {
+		waiter = new SelectWaiter;
+		waiter->wake = new Semaphore ("select", 0);
+		waiter->inList = FALSE;
+		waiter->timerPending = timeout > 0;
+		waiter->expired = FALSE;
+		waiter->done = FALSE;
+		// not a TimerInt: an idle machine does not wait for those,
+		// and the timeout matters most when nothing else happens
+		if (timeout > 0)
+		    interrupt->Schedule (SelectTimeout, (int) waiter, timeout,
+					 NetworkTimerInt);
+	    }
+	  if (!waiter->inList)
+	    {
+		selectWaiters.Append (waiter);
+		waiter->inList = TRUE;
+	    }
+	  waiter->wake->P ();
+      }
+    if (waiter != NULL)
+      {
+	  waiter->done = TRUE;
+	  FreeWaiter (waiter);
+      }
+    (void) interrupt->SetLevel (oldLevel);
+
+    if (numReady < 0)
+	return -1;
+    for (i = 0; i < numEntries; i++)
+	if (!machine->WriteMem (entries + (3 * i + 2) * sizeof (int), 4,
+				ready[i]))
+	    return -1;
+    return numReady;
+}
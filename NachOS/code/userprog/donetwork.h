@@ -0,0 +1,30 @@
+// donetwork.h
+//      Network ports and Select, for the system calls of user programs
+//      (see syscall.h).
+
+#ifndef DONETWORK_H
+#define DONETWORK_H
+
+#include "copyright.h"
+#include "system.h"
+
+#define MaxPorts 16		// ports open at once, all processes together
+#define MaxPortQueue 32		// messages waiting in a port, the next
+				// ones are dropped
+#define MaxSelectEntries 32
+
+extern int do_PortOpen(int box, int flags);
+extern int do_PortClose(int port);
+extern int do_PortSend(int port, int to, int buf, int size);
+extern int do_PortReceive(int port, int from, int buf, int size);
+extern int do_Select(int entries, int numEntries, int timeout);
+
+// Close the ports of a process that exits
+extern void ClosePorts(AddrSpace *space);
+
+// Something a thread may wait for in Select happened (a message in a
+// port, input on a console): wake them all to check.  Can be called
+// by interrupt handlers.
+extern void WakeSelect();
+
+#endif // DONETWORK_H
@@ -27,6 +27,7 @@
 #include "userthread.h"
 #include "forkexec.h"
 #include "dofilesys.h"
+#include "donetwork.h"
 
 
 //----------------------------------------------------------------------
@@ -74,6 +75,10 @@ ExceptionHandler (ExceptionType which)
 {
     int type = machine->ReadRegister (2);
 
+    // another thread of the process faulted or called Exit
+    if(currentThread->space->killed)
+      do_Kill();
+
 
 
 
@@ -90,6 +95,8 @@ ExceptionHandler (ExceptionType which)
         }
         case SC_Exit:
         {
+          if (currentThread->tid >= 0)	// a user thread ends the process
+            do_Kill();
           do_Exit();
           interrupt->Halt ();
           break;
@@ -99,7 +106,7 @@ ExceptionHandler (ExceptionType which)
         {
           char c;
           c = (char) machine->ReadRegister (4); //int to char conversion
-          synchconsole->SynchPutChar(c);  //value in registers is in int asciii
+          currentThread->space->console->SynchPutChar(c);  //value in registers is in int asciii
           break;
         }
 
@@ -111,7 +118,7 @@ ExceptionHandler (ExceptionType which)
           int from;
           from = machine->ReadRegister(4); //Register 4 contains address of string
           synchconsole->copyStringFromMachine(from,to_buf,MAX_STRING_SIZE);
-          synchconsole->SynchPutString(to_buf);//  synchconsole  SynchPutString is used
+          currentThread->space->console->SynchPutString(to_buf);//  synchconsole  SynchPutString is used
           delete [] to_buf;
           break;
 
@@ -119,7 +126,7 @@ ExceptionHandler (ExceptionType which)
         case SC_GetChar:
         {
           int ch;
-          ch = (int) synchconsole->SynchGetChar();   //(int at begining)
+          ch = (int) currentThread->space->console->SynchGetChar();   //(int at begining)
           machine->WriteRegister(2, ch);
           break;
         }
@@ -131,7 +138,7 @@ ExceptionHandler (ExceptionType which)
 
           from = machine->ReadRegister(4);  //register 4 contains address of the string
           size = machine->ReadRegister(5);  // register 5  contains size of string
-          synchconsole->SynchGetString(buf, size);
+          currentThread->space->console->SynchGetString(buf, size);
           synchconsole->copyStringToMachine(buf, from, size); //copies a string from the MIPS mode to the Linux mode
           delete [] buf;
           break;
@@ -141,7 +148,7 @@ ExceptionHandler (ExceptionType which)
         {
           int val;
           val = machine->ReadRegister(4);
-          synchconsole->SynchPutInt(val);
+          currentThread->space->console->SynchPutInt(val);
           break;
 
         }
@@ -151,31 +158,42 @@ ExceptionHandler (ExceptionType which)
            int val, till;
 
            till = machine->ReadRegister(4);
-           synchconsole->SynchGetInt(&val);
+           currentThread->space->console->SynchGetInt(&val);
            machine->WriteMem(till, sizeof(int), val);
           break;
         }
 
         case SC_UserThreadCreate:
         {
-          //activeThreads
           int f = machine->ReadRegister (4);
           int arg = machine->ReadRegister (5);
+          int exitAddr = machine->ReadRegister (6);
           int r;
-          r = do_UserThreadCreate(f, arg);
+          r = do_UserThreadCreate(f, arg, exitAddr);
           machine->WriteRegister(2, r);
           break;
         }
         case SC_UserThreadExit:
         {
-          do_UserThreadExit();
+          int status = machine->ReadRegister (4);
+          do_UserThreadExit(status);
           break;
         }
 
         case SC_UserThreadJoin:
         {
           int arg = machine->ReadRegister (4);
-          do_UserThreadJoin(arg);
+          int r;
+          r = do_UserThreadJoin(arg);
+          machine->WriteRegister(2, r);
+          break;
+        }
+        case SC_UserThreadDetach:
+        {
+          int arg = machine->ReadRegister (4);
+          int r;
+          r = do_UserThreadDetach(arg);
+          machine->WriteRegister(2, r);
           break;
         }
 
@@ -183,7 +201,79 @@ ExceptionHandler (ExceptionType which)
         {
           int s = machine->ReadRegister (4);
           int r;
-          r = do_ForkExec(s);
+          r = do_ForkExec(s, -1);
+          machine->WriteRegister(2, r);
+          break;
+        }
+
+        case SC_ForkExecTerm:
+        {
+          int s = machine->ReadRegister (4);
+          int terminal = machine->ReadRegister (5);
+          int r;
+          r = do_ForkExec(s, terminal);
+          machine->WriteRegister(2, r);
+          break;
+        }
+
+        case SC_PortOpen:
+        {
+          int box = machine->ReadRegister (4);
+          int flags = machine->ReadRegister (5);
+          int r;
+          r = do_PortOpen(box, flags);
+          machine->WriteRegister(2, r);
+          break;
+        }
+
+        case SC_PortClose:
+        {
+          int port = machine->ReadRegister (4);
+          int r;
+          r = do_PortClose(port);
+          machine->WriteRegister(2, r);
+          break;
+        }
+
+        case SC_PortSend:
+        {
+          int port = machine->ReadRegister (4);
+          int to = machine->ReadRegister (5);
+          int buf = machine->ReadRegister (6);
+          int size = machine->ReadRegister (7);
+          int r;
+          r = do_PortSend(port, to, buf, size);
+          machine->WriteRegister(2, r);
+          break;
+        }
+
+        case SC_PortReceive:
+        {
+          int port = machine->ReadRegister (4);
+          int from = machine->ReadRegister (5);
+          int buf = machine->ReadRegister (6);
+          int size = machine->ReadRegister (7);
+          int r;
+          r = do_PortReceive(port, from, buf, size);
+          machine->WriteRegister(2, r);
+          break;
+        }
+
+        case SC_Select:
+        {
+          int entries = machine->ReadRegister (4);
+          int numEntries = machine->ReadRegister (5);
+          int timeout = machine->ReadRegister (6);
+          int r;
+          r = do_Select(entries, numEntries, timeout);
+          machine->WriteRegister(2, r);
+          break;
+        }
+
+        case SC_Fork:
+        {
+          int r;
+          r = do_Fork();
           machine->WriteRegister(2, r);
           break;
         }
@@ -288,6 +378,30 @@ ExceptionHandler (ExceptionType which)
           machine->WriteRegister(2, r);
           break;
         }
+        case SC_Mmap:
+        {
+          int arg1 = machine->ReadRegister (4);
+          int arg2 = machine->ReadRegister (5);
+          int arg3 = machine->ReadRegister (6);
+          int r;
+          r = do_Mmap(arg1, arg2, arg3);
+          machine->WriteRegister(2, r);
+          break;
+        }
+        case SC_Munmap:
+        {
+          int arg1 = machine->ReadRegister (4);
+          int r;
+          r = do_Munmap(arg1);
+          machine->WriteRegister(2, r);
+          break;
+        }
+        case SC_Sbrk:
+        {
+          int increment = machine->ReadRegister (4);
+          machine->WriteRegister(2, currentThread->space->Sbrk(increment));
+          break;
+        }
 
 
         case SC_SemInit:
@@ -319,6 +433,31 @@ ExceptionHandler (ExceptionType which)
         UpdatePC ();
 
     }
+    else if(which == PageFaultException)
+    {
+      int badVAddr = machine->ReadRegister (BadVAddrReg);
+      admission->PageFault(currentThread->space); // waits if suspended
+      bool paged = currentThread->space->HandlePageFault(badVAddr);
+      admission->PageFaultDone(currentThread->space);
+      if(!paged)
+      {
+        printf ("Bad address or out of memory at 0x%x, process %d killed\n",
+                badVAddr, currentThread->space->pro);
+        do_Kill();
+      }
+      // the faulting instruction is restarted, do not update the PC
+    }
+    else if(which == ReadOnlyException)
+    {
+      int badVAddr = machine->ReadRegister (BadVAddrReg);
+      if(!currentThread->space->HandleReadOnlyFault(badVAddr))
+      {
+        printf ("Illegal write at address 0x%x, process %d killed\n",
+                badVAddr, currentThread->space->pro);
+        do_Kill();
+      }
+      // the faulting instruction is restarted, do not update the PC
+    }
 
 
 
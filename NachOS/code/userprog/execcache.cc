@@ -0,0 +1,277 @@
+// execcache.cc
+//      Routines to keep the images of executables in memory, and to
+//      share their code pages between address spaces.
+
+#include "copyright.h"
+#include "system.h"
+#include "execcache.h"
+
+#include <strings.h>		/* for bcopy */
+
+//----------------------------------------------------------------------
+// ExecutableCache::ExecutableCache
+//      Initialize an empty cache.
+//----------------------------------------------------------------------
+
+ExecutableCache::ExecutableCache ()
+{
+    images = NULL;
+    numImages = 0;
+    lock = new Semaphore ("lock_execcache", 1);
+}
+
+//----------------------------------------------------------------------
+// ExecutableCache::~ExecutableCache
+//      Drop every image, giving their frames back.
+//----------------------------------------------------------------------
+
+ExecutableCache::~ExecutableCache ()
+{
+    while (images != NULL)
+	Remove (images);
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// ExecutableCache::Find
+//      Look for the image of the file "fileId", and make it the most
+//      recently used.  The length of the file is checked too, in case
+//      it was rewritten.  The caller holds a reference on the image
+//      until it calls Release: building an address space from it may
+//      wait for the disk, and other processes may fill the cache or
+//      need frames meanwhile.
+//----------------------------------------------------------------------
+
+CachedExecutable *
+ExecutableCache::Find (int fileId, int length)
+{
+    CachedExecutable **link, *image;
+
+    lock->P ();
+    for (link = &images; *link != NULL; link = &(*link)->next)
+	if ((*link)->fileId == fileId && (*link)->length == length)
+	    break;
+    image = *link;
+    if (image != NULL)
+      {
+	  *link = image->next;
+	  image->next = images;
+	  images = image;
+	  image->refCount++;
+      }
+    lock->V ();
+    return image;
+}
+
+//----------------------------------------------------------------------
+// ExecutableCache::Release
+//      Drop the reference Find gave on "image", and free it if it left
+//      the cache in the meantime.
+//----------------------------------------------------------------------
+
+void
+ExecutableCache::Release (CachedExecutable *image)
+{
+    lock->P ();
+    ASSERT (image->refCount > 0);
+    image->refCount--;
+    if (image->refCount == 0 && image->dropped)
+	Free (image);
+    lock->V ();
+}
+
+//----------------------------------------------------------------------
+// ExecutableCache::Insert
+//      Copy the first "numImagePages" pages of the program loaded in
+//      "space", and remember its shared code frames.  Nothing is
+//      done if another process loaded the same file in the meantime.
+//      The least recently used image not in use goes if the cache is
+//      full; if they are all in use, the program is not cached.
+//----------------------------------------------------------------------
+
+void
+ExecutableCache::Insert (int fileId, int length, NoffHeader *noffH,
+			 AddrSpace *space, unsigned int numImagePages,
+			 unsigned int firstPage, unsigned int numPages)
+{
+    CachedExecutable *image, *victim;
+    unsigned int i;
+
+    lock->P ();
+    for (image = images; image != NULL; image = image->next)
+	if (image->fileId == fileId && image->length == length)
+	  {
+	      lock->V ();
+	      return;
+	  }
+
+    if (numImages == MaxCachedExecutables)
+      {
+	  victim = NULL;
+	  for (image = images; image != NULL; image = image->next)
+	      if (image->refCount == 0)
+		  victim = image;	// the last one is the least recent
+	  if (victim == NULL)
+	    {
+		lock->V ();
+		return;
+	    }
+	  Remove (victim);
+      }
+
+    image = new CachedExecutable;
+    image->fileId = fileId;
+    image->length = length;
+    image->noffH = *noffH;
+    image->numImagePages = numImagePages;
+    image->image = new char[numImagePages * PageSize];
+    for (i = 0; i < numImagePages; i++)
+	bcopy (&machine->mainMemory[space->PageEntry (i)->physicalPage
+				    * PageSize],
+	       &image->image[i * PageSize], PageSize);
+    image->firstPage = firstPage;
+    image->numPages = numPages;
+    image->frames = NULL;
+    image->refCount = 0;
+    image->dropped = FALSE;
+    image->next = images;
+    images = image;
+    numImages++;
+    lock->V ();
+
+    DEBUG ('a', "Caching %d pages of file %d\n", numImagePages, fileId);
+    ShareFrames (image, space);
+}
+
+//----------------------------------------------------------------------
+// ExecutableCache::ShareFrames
+//      Take a reference on the code frames of "space", the next
+//      address spaces running "image" will map them.
+//----------------------------------------------------------------------
+
+void
+ExecutableCache::ShareFrames (CachedExecutable *image,
+			      AddrSpace *space)
+{
+    unsigned int i;
+
+    lock->P ();
+    if (image->frames == NULL && image->numPages > 0)
+      {
+	  image->frames = new unsigned int[image->numPages];
+	  for (i = 0; i < image->numPages; i++)
+	    {
+		image->frames[i] =
+		    space->PageEntry (image->firstPage + i)->physicalPage;
+		frameProvider->AddFrameRef (image->frames[i]);
+	    }
+      }
+    lock->V ();
+}
+
+//----------------------------------------------------------------------
+// ExecutableCache::Invalidate
+//      Forget about "fileId".  The address spaces still running it keep
+//      their mapping, the frames are freed when the last one exits.
+//----------------------------------------------------------------------
+
+void
+ExecutableCache::Invalidate (int fileId)
+{
+    CachedExecutable *image, *next;
+
+    lock->P ();
+    for (image = images; image != NULL; image = next)
+      {
+	  next = image->next;
+	  if (image->fileId == fileId)
+	      Remove (image);
+      }
+    lock->V ();
+}
+
+//----------------------------------------------------------------------
+// ExecutableCache::Reclaim
+//      Free the code frames only the cache still references, starting
+//      from the least recently used image.  The images themselves stay
+//      in the cache.
+//----------------------------------------------------------------------
+
+unsigned int
+ExecutableCache::Reclaim (unsigned int numFrames, CachedExecutable *keep)
+{
+    CachedExecutable *order[MaxCachedExecutables], *image;
+    unsigned int freed = 0;
+    int n = 0;
+
+    lock->P ();
+    for (image = images; image != NULL; image = image->next)
+	order[n++] = image;
+    while (--n >= 0 && freed < numFrames)
+      {
+	  image = order[n];
+	  if (image != keep && image->refCount == 0 && image->frames != NULL
+	      && frameProvider->FrameRefCount (image->frames[0]) == 1)
+	    {
+		freed += image->numPages;
+		DropFrames (image);
+	    }
+      }
+    lock->V ();
+    return freed;
+}
+
+//----------------------------------------------------------------------
+// ExecutableCache::Remove
+//      Unlink "image" and free it, or let the last Release free it if
+//      it is in use.  The caller holds the lock.
+//----------------------------------------------------------------------
+
+void
+ExecutableCache::Remove (CachedExecutable *image)
+{
+    CachedExecutable **link;
+
+    for (link = &images; *link != image; link = &(*link)->next)
+	ASSERT (*link != NULL);
+    *link = image->next;
+    numImages--;
+
+    DEBUG ('a', "Dropping the image of file %d\n", image->fileId);
+    image->dropped = TRUE;
+    if (image->refCount == 0)
+	Free (image);
+}
+
+//----------------------------------------------------------------------
+// ExecutableCache::Free
+//      Free "image", out of the cache and unused.  The caller holds the
+//      lock.
+//----------------------------------------------------------------------
+
+void
+ExecutableCache::Free (CachedExecutable *image)
+{
+    DropFrames (image);
+    delete [] image->image;
+    delete image;
+}
+
+//----------------------------------------------------------------------
+// ExecutableCache::DropFrames
+//      Drop the references of the cache on the code frames of "image".
+//      The caller holds the lock.
+//----------------------------------------------------------------------
+
+void
+ExecutableCache::DropFrames (CachedExecutable *image)
+{
+    unsigned int i;
+
+    if (image->frames == NULL)
+	return;
+    for (i = 0; i < image->numPages; i++)
+	frameProvider->ReleaseFrame (image->frames[i]);
+    delete [] image->frames;
+    image->frames = NULL;
+}
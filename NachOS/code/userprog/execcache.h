@@ -0,0 +1,84 @@
+// execcache.h
+//      Cache of the executables run recently.
+//
+//      For each of them the cache keeps the parsed NOFF header and an
+//      image of the code and initialized data, laid out page by page,
+//      so that starting the program again is a header lookup and a
+//      memory copy per page, with no access to the file.
+//
+//      Moreover, every address space loaded from the same file maps the
+//      same read-only frames for the pages that hold nothing but code.
+//      The cache keeps one reference on each of these frames (see
+//      FrameProvider::AddFrameRef), so that the code stays in memory
+//      between two runs of a program, until the frames are needed.
+
+#ifndef EXECCACHE_H
+#define EXECCACHE_H
+
+#include "copyright.h"
+#include "synch.h"
+#include "translate.h"
+#include "noff.h"
+
+class AddrSpace;
+
+#define MaxCachedExecutables 8	// images kept in host memory
+
+class CachedExecutable {
+  public:
+    int fileId;			// header sector of the executable
+    int length;			// length of the file when it was loaded
+    NoffHeader noffH;		// header, already in host byte order
+    unsigned int numImagePages;	// pages holding code or initialized data
+    char *image;		// their content
+    unsigned int firstPage;	// first virtual page of the shared code
+    unsigned int numPages;	// number of shared code pages
+    unsigned int *frames;	// frame of each of them, NULL if they have
+				// been reclaimed
+    int refCount;		// address spaces being built from it, it
+				// is neither freed nor reclaimed meanwhile
+    bool dropped;		// out of the cache, freed on the last
+				// Release
+    CachedExecutable *next;
+};
+
+class ExecutableCache {
+  public:
+    ExecutableCache ();
+    ~ExecutableCache ();
+
+    // Image of the executable, NULL if it is not in the cache.  It
+    // stays valid until given to Release.
+    CachedExecutable *Find (int fileId, int length);
+    void Release (CachedExecutable *image);
+
+    // Record the image of the program just loaded in "space",
+    // the cache takes its own reference on the shared code frames
+    void Insert (int fileId, int length, NoffHeader *noffH,
+		 AddrSpace *space, unsigned int numImagePages,
+		 unsigned int firstPage, unsigned int numPages);
+
+    // Share again the code frames of "image", after they have been
+    // reclaimed, using the ones just loaded in "space"
+    void ShareFrames (CachedExecutable *image, AddrSpace *space);
+
+    // The file was removed, its header sector may be reused
+    void Invalidate (int fileId);
+
+    // Free the code frames no address space maps anymore, least
+    // recently used first, except the ones of "keep" and of the images
+    // in use, until
+    // "numFrames" frames have been freed.  Return the number freed.
+    unsigned int Reclaim (unsigned int numFrames, CachedExecutable *keep);
+
+  private:
+    CachedExecutable *images;	// most recently used first
+    int numImages;
+    Semaphore *lock;
+
+    void Remove (CachedExecutable *image);	// frees it unless in use
+    void Free (CachedExecutable *image);
+    void DropFrames (CachedExecutable *image);
+};
+
+#endif // EXECCACHE_H
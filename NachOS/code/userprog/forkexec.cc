@@ -4,29 +4,48 @@
 
 //int tidcounter = 0;
 
-// Check if there is space to allocate the process
+// Number of frames the process needs to start, -1 if it can never
+// fit in memory.  Whether it fits now is up to the admission control.
 static int CheckPhysicalSpace (OpenFile * executable)
 {
     NoffHeader noffH;
-    executable->ReadAt ((char *) &noffH, sizeof (noffH), 0);
-
-    unsigned int size = noffH.code.size + noffH.initData.size + noffH.uninitData.size + UserStackSize;
-    unsigned int nmPgs = divRoundUp (size, PageSize);
-    unsigned int framesAvailabe = frameProvider->NumAvailFrame();
-    
-    if(framesAvailabe < nmPgs)
+    CachedExecutable *cached = execCache->Find (executable->HeaderSector(),
+                                                executable->Length());
+    if(cached != NULL)
+    	noffH = cached->noffH;
+    else
+    	executable->ReadAt ((char *) &noffH, sizeof (noffH), 0);
+
+    // the rest of the address space is only allocated when it is
+    // touched, count at least one stack page
+    unsigned int nmPgs = ImagePages (&noffH) + 1;
+    if(nmPgs > NumPhysPages - frameProvider->NumReservedFrames())
     	return -1;
 
-    return 0;
+    // the code pages of a program already running are shared
+    unsigned int codeFirstPage, codeNumPages;
+    SharedCodePages (&noffH, &codeFirstPage, &codeNumPages);
+    if(cached != NULL && cached->frames != NULL)
+    	nmPgs -= codeNumPages;
+    if(cached != NULL)
+    	execCache->Release (cached);
+
+    return nmPgs;
 }
 
 
 static void StartForkedProcess (int s){
 
 	ProcArgs_t* procargs = (ProcArgs_t*) s;
-	AddrSpace *space = (AddrSpace*) procargs->space;
 	int procnum = procargs->procnum;
 
+	// wait until memory is available, the parent is not blocked
+	admission->Admit (procargs->numPages);
+	AddrSpace *space = new AddrSpace (procargs->executable);
+	admission->Started (space, procargs->numPages);
+	space->console = procargs->console;
+	delete procargs->executable;		// close file
+	delete procargs;
 
     currentThread->space = space;
     currentThread->space->pro = procnum;
@@ -42,7 +61,10 @@ static void StartForkedProcess (int s){
 }
 
 
-int do_ForkExec(int s){
+int do_ForkExec(int s, int terminal){
+
+	if(terminal < -1 || terminal >= numTerminals)
+		return -1;		// -1 only stands for the parent's
 
 	interthread_lock->P();
     procounter++;
@@ -51,6 +73,10 @@ int do_ForkExec(int s){
 
 	ProcArgs_t *procargs = new ProcArgs_t;
 	procargs->procnum = this_pro;
+	if(terminal == -1)
+		procargs->console = currentThread->space->console;
+	else
+		procargs->console = terminals[terminal];
 
 	int i;
 	int value;
@@ -77,7 +103,7 @@ int do_ForkExec(int s){
 	filename[i] = 0x00;
 
     OpenFile *executable = fileSystem->Open (filename);
-    AddrSpace *space;
+    int numPages;
 
     if (executable == NULL){
 		printf ("Unable to open file %s\n", filename);
@@ -87,7 +113,8 @@ int do_ForkExec(int s){
 		delete executable;
 		return -1;
 	}
-	if(CheckPhysicalSpace (executable) < 0){
+	numPages = CheckPhysicalSpace (executable);
+	if(numPages < 0){
 		printf ("Not enough space to run process %s\n", filename);
 		interthread_lock->P();
     	procounter--;
@@ -99,11 +126,8 @@ int do_ForkExec(int s){
 	livepro++;
 	lock_livepro->V();
 
-    space = new AddrSpace (executable);
-    procargs->space = (int)space;
-
-    delete executable;		// close file
-
+    procargs->executable = executable;
+    procargs->numPages = numPages;
 
 	//Create the thread*/
     Thread *t = new Thread ("Process thread");
@@ -112,6 +136,72 @@ int do_ForkExec(int s){
     return this_pro;
 }
 
+// The child of a Fork resumes right after the syscall, with the
+// registers of its parent and 0 as return value
+static void StartForkedChild (int a){
+
+	ForkArgs_t* forkargs = (ForkArgs_t*) a;
+
+	currentThread->space = forkargs->space;
+	for(int i = 0; i < NumTotalRegs; i++)
+		machine->WriteRegister(i, forkargs->registers[i]);
+	delete forkargs;
+
+	machine->WriteRegister(2, 0);
+	int pc = machine->ReadRegister (PCReg);
+	machine->WriteRegister (PrevPCReg, pc);
+	pc = machine->ReadRegister (NextPCReg);
+	machine->WriteRegister (PCReg, pc);
+	machine->WriteRegister (NextPCReg, pc + 4);
+
+	currentThread->space->RestoreState ();	// load page table register
+
+	machine->Run ();		// jump back to the user progam
+	ASSERT (FALSE);
+}
+
+// Unix-like fork: duplicate the current process, sharing its frames
+// copy-on-write.  Only the calling thread is duplicated.
+// Return the pid of the child, or -1 on error
+int do_Fork(){
+
+	AddrSpace *parent = currentThread->space;
+
+	interthread_lock->P();
+	if(procounter + 1 >= MaxNumPro){
+		interthread_lock->V();
+		printf ("Too many processes, Fork failed\n");
+		return -1;
+	}
+	procounter++;
+	int this_pro = procounter;
+	interthread_lock->V();
+
+	//The child keeps running on the user stack of the forking thread
+	int stackSlot = 0;
+	parent->lock_threads->P();
+	UserThreadEntry *entry = parent->FindUserThread(currentThread->tid);
+	if(entry != NULL)
+		stackSlot = entry->stackSlot;
+	parent->lock_threads->V();
+
+	lock_livepro->P();
+	livepro++;
+	lock_livepro->V();
+
+	ForkArgs_t *forkargs = new ForkArgs_t;
+	forkargs->space = new AddrSpace (parent, stackSlot);
+	forkargs->space->pro = this_pro;
+	admission->Started (forkargs->space, 0);
+	for(int i = 0; i < NumTotalRegs; i++)
+		forkargs->registers[i] = machine->ReadRegister(i);
+
+    Thread *t = new Thread ("Forked process");
+    t->Fork (StartForkedChild, (int)(forkargs));
+
+	return this_pro;
+}
+
 void do_UserWaitPid(int pid){
 	createdPro[pid]->P();
 	createdPro[pid]->V();
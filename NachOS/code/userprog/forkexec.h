@@ -3,9 +3,18 @@
 
 typedef struct ProcArgs
 {
-	int space;
+	OpenFile *executable;	//loaded by the new thread once admitted
+	unsigned int numPages;	//frames it needs to start
 	int procnum;	
+	SynchConsole *console;	//terminal it runs on
 }ProcArgs_t;
 
-extern int do_ForkExec(int s);
+typedef struct ForkArgs
+{
+	AddrSpace *space;
+	int registers[NumTotalRegs];	//user registers of the parent
+}ForkArgs_t;
+
+extern int do_ForkExec(int s, int terminal); //-1: terminal of the parent
+extern int do_Fork();
 extern void do_UserWaitPid(int pid);
@@ -7,83 +7,370 @@
 #include <time.h>       /* time */
 
 
-FrameProvider::FrameProvider(unsigned int numOfFrames){
+FrameProvider::FrameProvider(unsigned int numOfFrames,
+                             unsigned int numOfColors,
+                             unsigned int numOfReserved){
 	srand (time(NULL));
 	allocatedFrames = new BitMap(numOfFrames);
 	numPages = numOfFrames;
+	refCount = new unsigned int[numOfFrames];
+	for(unsigned int i = 0; i < numOfFrames; i++)
+		refCount[i] = 0;
+	//the machine starts with a zero-filled memory
+	zeroedFrames = new BitMap(numOfFrames);
+	for(unsigned int i = 0; i < numOfFrames; i++)
+		zeroedFrames->Mark(i);
+	framesToZero = new Semaphore("framesToZero", 0);
+
+	ASSERT(numOfColors > 0 && numOfReserved < numOfFrames);
+	numColors = numOfColors;
+	numReserved = numOfReserved;
+	numFree = 0;
+	zeroedList = new int[numColors];
+	dirtyList = new int[numColors];
+	for(unsigned int c = 0; c < numColors; c++){
+		zeroedList[c] = -1;
+		dirtyList[c] = -1;
+	}
+	nextFree = new int[numOfFrames];
+	prevFree = new int[numOfFrames];
+	runFree = new unsigned int[NumRuns()];
+	for(unsigned int r = 0; r < NumRuns(); r++)
+		runFree[r] = HugePageFactor;
+	numFreeRuns = NumRuns();
+	fragmented = FALSE;
+	compactionPending = FALSE;
+	fragmentedSem = new Semaphore("fragmented", 0);
+	//lowest frames on top of the lists, as with AS_ORDERED
+	for(int i = numPages - 1; i >= 0; i--){
+		Link(i);
+		numFree++;
+	}
 }
 
 FrameProvider::~FrameProvider()
 {
 	delete allocatedFrames;
+	delete [] refCount;
+	delete zeroedFrames;
+	delete framesToZero;
+	delete [] zeroedList;
+	delete [] dirtyList;
+	delete [] nextFree;
+	delete [] prevFree;
+	delete [] runFree;
+	delete fragmentedSem;
 }
 
-unsigned int
+//Allocate a frame following one of the AS_* strategies, -1 if only
+//the reserve is left
+int
 FrameProvider::GetEmptyFrame(int allocationStrategie){
-	int selectedFrame = 0;
+	int selectedFrame = -1;
+	int i;
+
+	if(numFree <= numReserved)
+		return -1;
+
 	switch(allocationStrategie){
 		case AS_ORDERED:
 			selectedFrame = allocatedFrames->Find();
+			if(selectedFrame >= 0)
+				allocatedFrames->Clear(selectedFrame); //Take marks it
 			break;
 
 		case AS_RANDOM:
-			int i, j;
-			
-			selectedFrame = rand() % numPages;
-
-		    for(i = selectedFrame; i < numPages; i++)
-		    	//Make sure selectedFrame is free, otherwise look for the next one
+			//Look for a free frame from a random one, wrapping around
+			//at the end of the memory
+			i = rand() % numPages;
+			for(int n = 0; n < numPages; n++, i = (i + 1) % numPages)
 				if(!allocatedFrames->Test(i)){
-					allocatedFrames->Mark(i);
-			    	selectedFrame = i;
-			    	break;
-			  	}
-			//If we reached the end of the list, start over from the beginnig
-			if(i == numPages){
-			    for(j = 0; j < numPages; j++)
-					if(!allocatedFrames->Test(j)){
-						allocatedFrames->Mark(j);
-				    	selectedFrame = j;
-				    	break;
-				  	}
-				//If we reached the end of the list, there is not empty place left
-				if(i == selectedFrame)
-					selectedFrame = -1;
-			}
+					selectedFrame = i;
+					break;
+				}
 			break;
 
 		case AS_INVERSE:
-			for(i = numPages - 1; i >= 0; i--){
+			for(i = numPages - 1; i >= 0; i--)
 				if(!allocatedFrames->Test(i)){
-					allocatedFrames->Mark(i);
-			    	selectedFrame = i;
-			    	break;
-			  	}				
-			}
-			if(i < 0)
-				selectedFrame = -1;
+					selectedFrame = i;
+					break;
+				}
 			break;
 
+		case AS_FREELIST:
+			return GetColoredFrame(0, FALSE);
+
 		default:
 			break;
 	}
-	
-	if(selectedFrame >= 0)
-		bzero (&machine->mainMemory[PageSize*selectedFrame], PageSize);
-	return selectedFrame;
+
+	if(selectedFrame < 0)
+		return -1;
+	return Take(selectedFrame);
+}
+
+//Constant time allocation (for a given number of colors): the frames
+//of the color asked for come first, zeroed ones first
+int
+FrameProvider::GetColoredFrame(unsigned int color, bool fromReserve){
+
+	if(numFree == 0 || (!fromReserve && numFree <= numReserved))
+		return -1;
+
+	for(unsigned int k = 0; k < numColors; k++){
+		unsigned int c = (color + k) % numColors;
+		if(zeroedList[c] >= 0)
+			return Take(zeroedList[c]);
+		if(dirtyList[c] >= 0)
+			return Take(dirtyList[c]);
+	}
+	ASSERT(FALSE);	//numFree is wrong
+	return -1;
+}
+
+//Slow path, looks for an aligned run of free frames: only tried when a
+//whole group of pages is loaded at once
+int
+FrameProvider::GetHugeFrame(bool fromReserve){
+
+	unsigned int needed = HugePageFactor + (fromReserve ? 0 : numReserved);
+	int base, i;
+
+	if(numFree < needed)
+		return -1;
+	for(unsigned int r = 0; r < NumRuns(); r++)
+		if(runFree[r] == HugePageFactor){
+			base = r * HugePageFactor;
+			for(i = base; i < base + HugePageFactor; i++)
+				Take(i);
+			return base;
+		}
+	//enough free frames, but scattered
+	if(!compactionPending){
+		compactionPending = TRUE;
+		fragmentedSem->V();
+	}
+	return -1;
 }
 
 void
 FrameProvider::ReleaseFrame(unsigned int frameNumber){
 
-	allocatedFrames->Clear(frameNumber);
+	ASSERT(refCount[frameNumber] > 0);
+	refCount[frameNumber]--;
+	if(refCount[frameNumber] == 0){
+		allocatedFrames->Clear(frameNumber);
+		Link(frameNumber);
+		numFree++;
+		if(frameNumber / HugePageFactor < NumRuns()
+		   && ++runFree[frameNumber / HugePageFactor] == HugePageFactor)
+			numFreeRuns++;
+		UpdateFragmentation();
+		CheckFragmentation();
+		framesToZero->V();
+	}
+
+}
 
+//Remove a free frame from its list and give it to the caller,
+//zero-filled
+unsigned int
+FrameProvider::Take(int frame){
+
+	ASSERT(!allocatedFrames->Test(frame));
+	Unlink(frame);
+	allocatedFrames->Mark(frame);
+	numFree--;
+	if((unsigned) frame / HugePageFactor < NumRuns()
+	   && runFree[frame / HugePageFactor]-- == HugePageFactor)
+		numFreeRuns--;
+	UpdateFragmentation();
+	refCount[frame] = 1;
+	if(zeroedFrames->Test(frame))
+		zeroedFrames->Clear(frame);
+	else
+		bzero (&machine->mainMemory[PageSize*frame], PageSize);
+	return frame;
 }
 
+//Push a free frame on the list of its color, zeroed or not
+void
+FrameProvider::Link(int frame){
+
+	int *list = zeroedFrames->Test(frame) ? zeroedList : dirtyList;
+	unsigned int c = frame % numColors;
+
+	prevFree[frame] = -1;
+	nextFree[frame] = list[c];
+	if(list[c] >= 0)
+		prevFree[list[c]] = frame;
+	list[c] = frame;
+}
+
+void
+FrameProvider::Unlink(int frame){
+
+	int *list = zeroedFrames->Test(frame) ? zeroedList : dirtyList;
+	unsigned int c = frame % numColors;
+
+	if(prevFree[frame] >= 0)
+		nextFree[prevFree[frame]] = nextFree[frame];
+	else
+		list[c] = nextFree[frame];
+	if(nextFree[frame] >= 0)
+		prevFree[nextFree[frame]] = prevFree[frame];
+}
+
+void
+FrameProvider::AddFrameRef(unsigned int frameNumber){
+
+	ASSERT(refCount[frameNumber] > 0);
+	refCount[frameNumber]++;
+
+}
+
+unsigned int
+FrameProvider::FrameRefCount(unsigned int frameNumber){
+
+	return refCount[frameNumber];
+
+}
+
+
+void
+FrameProvider::StartZeroing(){
+
+	Thread *t = new Thread("frame zeroer");
+	t->Fork(ZeroFrames, (int) this);
+
+}
+
+//Body of the zeroing thread: zero one free frame per released frame,
+//giving the CPU back between two of them
+void
+FrameProvider::ZeroFrames(int arg){
+
+	FrameProvider *provider = (FrameProvider *) arg;
+
+	while(1){
+		provider->framesToZero->P();
+		for(unsigned int c = 0; c < provider->numColors; c++){
+			int frame = provider->dirtyList[c];
+			if(frame >= 0){
+				provider->Unlink(frame);
+				bzero (&machine->mainMemory[PageSize*frame], PageSize);
+				provider->zeroedFrames->Mark(frame);
+				provider->Link(frame);
+				break;
+			}
+		}
+		currentThread->Yield();
+	}
+
+}
+
+unsigned int
+FrameProvider::NumRuns(){
+
+	return numPages / HugePageFactor;
+
+}
+
+unsigned int
+FrameProvider::FreeFramesInRun(unsigned int run){
+
+	return runFree[run];
+
+}
+
+bool
+FrameProvider::FrameIsFree(unsigned int frameNumber){
+
+	return !allocatedFrames->Test(frameNumber);
+
+}
+
+int
+FrameProvider::Fragmentation(){
+
+	if(numFree == 0)
+		return 0;
+	return 100 * (numFree - numFreeRuns * HugePageFactor) / numFree;
+
+}
+
+//Constant time, called on every allocation and release
+void
+FrameProvider::UpdateFragmentation(){
+
+	stats->fragmentation = Fragmentation();
+	if(stats->fragmentation > stats->maxFragmentation)
+		stats->maxFragmentation = stats->fragmentation;
+
+}
+
+//Wake the compaction up when the fragmentation crosses the threshold,
+//if there are enough free frames for a huge page.  Not done in Take,
+//whose callers take several frames in a row.
+void
+FrameProvider::CheckFragmentation(){
+
+	bool now = Fragmentation() >= CompactionThreshold
+		&& numFree >= numReserved + HugePageFactor;
+
+	if(now && !fragmented && !compactionPending){
+		compactionPending = TRUE;
+		fragmentedSem->V();
+	}
+	fragmented = now;
+
+}
+
+void
+FrameProvider::WaitFragmented(){
+
+	fragmentedSem->P();
+	compactionPending = FALSE;
+
+}
+
+//Prefer the frames past the last run, then the runs with the fewest
+//free frames, never a run that is entirely free
+int
+FrameProvider::GetFrameOutsideRun(unsigned int run){
+
+	int best = -1;
+	unsigned int bestFree = HugePageFactor, free;
+
+	for(int i = 0; i < numPages; i++){
+		if(allocatedFrames->Test(i) || (unsigned) i / HugePageFactor == run)
+			continue;
+		free = (unsigned) i / HugePageFactor < NumRuns()
+			? runFree[i / HugePageFactor] : 0;
+		if(free < bestFree){
+			best = i;
+			bestFree = free;
+		}
+	}
+	if(best < 0)
+		return -1;
+	return Take(best);
+
+}
+
+unsigned int
+FrameProvider::NumReservedFrames(){
+
+	return numReserved;
+
+}
 
 unsigned int
 FrameProvider::NumAvailFrame(){
 
-	return allocatedFrames->NumClear();
+	if(numFree <= numReserved)
+		return 0;
+	return numFree - numReserved;
 
 }
\ No newline at end of file
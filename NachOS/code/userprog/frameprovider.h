@@ -4,25 +4,103 @@
 
 #include "copyright.h"
 #include "bitmap.h"
+#include "synch.h"
 
 #define AS_ORDERED 0
 #define AS_RANDOM 1
 #define AS_INVERSE 2
+#define AS_FREELIST 3	// O(1): the frame released last, zeroed if possible
 
+#define DefaultNumColors 1	// page colors, see GetColoredFrame
+#define DefaultReservedFrames 0	// frames only page faults can take
+#define CompactionThreshold 50	// fragmentation (percentage of the free
+				// frames outside a free huge page run)
+				// above which the pager compacts memory
 
+
+// Free frames are kept on lists, one per color, the ones known to be
+// zero-filled apart, so that allocating or releasing a frame takes
+// constant time.  The bitmap of allocated frames is still kept, for
+// the AS_ORDERED, AS_RANDOM and AS_INVERSE strategies.
+//
+// The color of a frame is its number modulo the number of colors: with
+// as many colors as the host cache has sets of a page, giving the
+// consecutive pages of a process frames of consecutive colors spreads
+// them over the whole cache.
 class FrameProvider
 {
     public:
-        FrameProvider(unsigned int numOfFrames);
+        FrameProvider(unsigned int numOfFrames, unsigned int numOfColors,
+                      unsigned int numOfReserved);
         ~FrameProvider();
 
-        unsigned int GetEmptyFrame(int allocationStrategie);
-        void ReleaseFrame(unsigned int frameNumber);
-        unsigned int NumAvailFrame();
+        int GetEmptyFrame(int allocationStrategie); // zero-filled, -1 if
+        // there is none
+        // Fast path, a frame of color "color" (modulo the number of
+        // colors) if there is one, -1 otherwise.  Only the page faults
+        // of running processes ("fromReserve") can take the last
+        // reserved frames.
+        int GetColoredFrame(unsigned int color, bool fromReserve);
+        // HugePageFactor free frames starting at a multiple of it, for a
+        // huge page; return the first one, or -1 if there is no such run
+        int GetHugeFrame(bool fromReserve);
+        void ReleaseFrame(unsigned int frameNumber); // drop one reference
+        unsigned int NumAvailFrame(); // not counting the reserve
+        unsigned int NumReservedFrames();
+
+        // A frame can be mapped by several address spaces (copy-on-write),
+        // it is only freed when the last of them releases it
+        void AddFrameRef(unsigned int frameNumber);
+        unsigned int FrameRefCount(unsigned int frameNumber);
+
+        // Free frames are zeroed in the background by a kernel thread,
+        // so that most allocations do not have to do it
+        void StartZeroing();
+
+        // Memory is seen as runs of HugePageFactor frames, aligned, the
+        // frames past the last whole run belonging to none.
+        // Fragmentation() is the percentage of the free frames outside
+        // the runs that are entirely free, also kept in stats.
+        unsigned int NumRuns();
+        unsigned int FreeFramesInRun(unsigned int run);
+        bool FrameIsFree(unsigned int frameNumber);
+        int Fragmentation();
+        // Block until the fragmentation gets above CompactionThreshold,
+        // or a huge page could not be found although enough frames
+        // were free
+        void WaitFragmented();
+        // A free frame to move a page of "run" to, taken from the
+        // fullest other run, -1 if there is none
+        int GetFrameOutsideRun(unsigned int run);
 
     private:
         BitMap *allocatedFrames;
 		int numPages;
+		unsigned int *refCount; // number of mappings of each frame
+		BitMap *zeroedFrames;	// free frames known to be zero-filled
+		Semaphore *framesToZero; // V'ed when a frame is released
+
+		unsigned int numColors;
+		unsigned int numReserved;
+		unsigned int numFree;
+		int *zeroedList;	// per color, first free zeroed frame
+		int *dirtyList;		// same, for the ones to zero
+		int *nextFree;		// links of the free lists, -1 at the end
+		int *prevFree;
+
+		unsigned int *runFree;	// free frames of each run
+		unsigned int numFreeRuns; // runs with all frames free
+		bool fragmented;	// above CompactionThreshold
+		bool compactionPending;	// fragmentedSem V'ed, not P'ed yet
+		Semaphore *fragmentedSem;
+		void UpdateFragmentation();
+		void CheckFragmentation();	// wake the compaction up
+
+		void Link(int frame);	// put it on its free list
+		void Unlink(int frame);
+		unsigned int Take(int frame);	// allocate a free frame
+
+		static void ZeroFrames(int arg);
 };
 
-#endif // FRAMEPROVIDER_H
\ No newline at end of file
+#endif // FRAMEPROVIDER_H
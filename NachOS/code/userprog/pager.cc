@@ -0,0 +1,470 @@
+// pager.cc
+//      Routines to choose the pages to evict, and to keep them in the
+//      swap space.
+
+#include "copyright.h"
+#include "system.h"
+#include "pager.h"
+#include "addrspace.h"
+
+#include <strings.h>		/* for bcopy */
+
+static const char *policyNames[] = { "fifo", "clock", "random" };
+
+//----------------------------------------------------------------------
+// Pager::Pager
+//      Initialize the pager.  "replacementPolicy" is PAGER_FIFO,
+//      PAGER_CLOCK or PAGER_RANDOM, the swap space holds "numSwap" pages.
+//----------------------------------------------------------------------
+
+Pager::Pager (int replacementPolicy, int numSwap)
+{
+    int i;
+
+    policy = replacementPolicy;
+    owner = new AddrSpace *[NumPhysPages];
+    ownerPage = new unsigned int[NumPhysPages];
+    loadTime = new unsigned int[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++)
+      {
+	  owner[i] = NULL;
+	  ownerPage[i] = 0;
+	  loadTime[i] = 0;
+      }
+    clock = 0;
+    hand = 0;
+
+    numSwapPages = numSwap;
+    swap = new char[numSwapPages * PageSize];
+    swapSlots = new BitMap (numSwapPages);
+}
+
+//----------------------------------------------------------------------
+// Pager::~Pager
+//----------------------------------------------------------------------
+
+Pager::~Pager ()
+{
+    delete [] owner;
+    delete [] ownerPage;
+    delete [] loadTime;
+    delete [] swap;
+    delete swapSlots;
+}
+
+//----------------------------------------------------------------------
+// Pager::GetFrame
+//      Return a zero-filled frame for page "vpn" of "space".  When no
+//      frame is free, the code frames only held by the executable cache
+//      go first, then a page chosen by the replacement policy is
+//      evicted.
+//
+//      The consecutive pages of a process get frames of consecutive
+//      colors, the processes starting from different colors.
+//
+//      The caller makes "space" the owner of the frame (see SetOwner)
+//      once the page is mapped.
+//----------------------------------------------------------------------
+
+int
+Pager::GetFrame (AddrSpace *space, unsigned int vpn, bool fromReserve)
+{
+    int frame, victim;
+
+    for (;;)
+      {
+	  frame = frameProvider->GetColoredFrame (vpn + space->pro,
+						  fromReserve);
+	  if (frame >= 0)
+	      return frame;
+	  if (execCache->Reclaim (1, NULL) > 0)
+	      continue;
+
+	  victim = ChooseVictim ();
+	  if (victim < 0)
+	      return -1;
+	  DEBUG ('a', "Evicting virtual page %d from frame %d, for page %d\n",
+		 ownerPage[victim], victim, vpn);
+	  if (!owner[victim]->PageOut (ownerPage[victim]))
+	      return -1;	// the swap space is full
+	  stats->numEvictions++;
+      }
+}
+
+//----------------------------------------------------------------------
+// Pager::SetOwner
+//      "space" maps "frame" at page "vpn", the frame can be taken back
+//      from it.
+//----------------------------------------------------------------------
+
+void
+Pager::SetOwner (unsigned int frame, AddrSpace *space, unsigned int vpn)
+{
+    owner[frame] = space;
+    ownerPage[frame] = vpn;
+    loadTime[frame] = ++clock;
+}
+
+//----------------------------------------------------------------------
+// Pager::Disown
+//      "space" does not map "frame" anymore.  Nothing is done if another
+//      address space owns it.
+//----------------------------------------------------------------------
+
+void
+Pager::Disown (unsigned int frame, AddrSpace *space)
+{
+    if (owner[frame] == space)
+	owner[frame] = NULL;
+}
+
+//----------------------------------------------------------------------
+// Pager::Evictable
+//      A frame can be evicted if it is mapped by its owner only.
+//----------------------------------------------------------------------
+
+bool
+Pager::Evictable (unsigned int frame)
+{
+    TranslationEntry *entry;
+
+    if (owner[frame] == NULL || frameProvider->FrameRefCount (frame) != 1)
+	return FALSE;
+    entry = owner[frame]->PageEntry (ownerPage[frame]);
+    return entry != NULL && entry->valid && entry->physicalPage == frame;
+}
+
+//----------------------------------------------------------------------
+// Pager::NumEvictableFrames
+//      Number of frames that could be given to a new process.
+//----------------------------------------------------------------------
+
+unsigned int
+Pager::NumEvictableFrames ()
+{
+    unsigned int n = 0;
+    int i;
+
+    for (i = 0; i < NumPhysPages; i++)
+	if (Evictable (i))
+	    n++;
+    if (n > (unsigned) swapSlots->NumClear ())
+	n = swapSlots->NumClear ();
+    return n;
+}
+
+//----------------------------------------------------------------------
+// Pager::ResidentFrames
+//      Number of frames "space" owns, an estimate of its working set.
+//----------------------------------------------------------------------
+
+unsigned int
+Pager::ResidentFrames (AddrSpace *space)
+{
+    unsigned int n = 0;
+    int i;
+
+    for (i = 0; i < NumPhysPages; i++)
+	if (owner[i] == space)
+	    n++;
+    return n;
+}
+
+//----------------------------------------------------------------------
+// Pager::SwapOut
+//      Evict every page of "space" that can be, to suspend it.
+//----------------------------------------------------------------------
+
+void
+Pager::SwapOut (AddrSpace *space)
+{
+    int i;
+
+    for (i = 0; i < NumPhysPages; i++)
+	if (owner[i] == space && Evictable (i))
+	  {
+	      if (!space->PageOut (ownerPage[i]))
+		  return;	// the swap space is full
+	      stats->numEvictions++;
+	  }
+}
+
+//----------------------------------------------------------------------
+// Pager::StartCompaction
+//      Fork the kernel thread that compacts memory whenever the frame
+//      provider finds it fragmented.
+//----------------------------------------------------------------------
+
+void
+Pager::StartCompaction ()
+{
+    Thread *t = new Thread ("compaction");
+
+    t->Fork (CompactionThread, (int) this);
+}
+
+void
+Pager::CompactionThread (int arg)
+{
+    Pager *self = (Pager *) arg;
+
+    for (;;)
+      {
+	  frameProvider->WaitFragmented ();
+	  self->Compact ();
+      }
+}
+
+//----------------------------------------------------------------------
+// Pager::Movable
+//      A frame can be moved if it could be evicted, and is not part of
+//      a huge page.
+//----------------------------------------------------------------------
+
+bool
+Pager::Movable (unsigned int frame)
+{
+    return Evictable (frame)
+	&& owner[frame]->HugePageEntry (ownerPage[frame]) == NULL;
+}
+
+//----------------------------------------------------------------------
+// Pager::Migrate
+//      Move the page in "frame" to the free frame "target", taken by
+//      the caller.  The page keeps its age for FIFO.  Return FALSE,
+//      doing nothing, if the page cannot be moved anymore.
+//----------------------------------------------------------------------
+
+bool
+Pager::Migrate (unsigned int frame, unsigned int target)
+{
+    if (!Movable (frame))
+	return FALSE;
+    DEBUG ('a', "Virtual page %d moved from frame %d to frame %d\n",
+	   ownerPage[frame], frame, target);
+    owner[frame]->MovePage (ownerPage[frame], target);
+    owner[target] = owner[frame];
+    ownerPage[target] = ownerPage[frame];
+    loadTime[target] = loadTime[frame];
+    owner[frame] = NULL;
+    frameProvider->ReleaseFrame (frame);
+    stats->numMigrations++;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Pager::ChooseRun
+//      Return the run of frames with the most free frames, but not all
+//      of them, whose other frames can all be moved.  -1 if none.
+//----------------------------------------------------------------------
+
+int
+Pager::ChooseRun ()
+{
+    unsigned int run, free, frame;
+    int best = -1;
+    unsigned int bestFree = 0;
+
+    for (run = 0; run < frameProvider->NumRuns (); run++)
+      {
+	  free = frameProvider->FreeFramesInRun (run);
+	  if (free <= bestFree || free == HugePageFactor)
+	      continue;
+	  for (frame = run * HugePageFactor;
+	       frame < (run + 1) * HugePageFactor; frame++)
+	      if (!frameProvider->FrameIsFree (frame) && !Movable (frame))
+		  break;
+	  if (frame == (run + 1) * HugePageFactor)
+	    {
+		best = run;
+		bestFree = free;
+	    }
+      }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// Pager::Compact
+//      Empty runs of frames, almost free ones first, until the memory
+//      is not fragmented anymore.  The CPU is given back after each
+//      page moved, the compaction only runs when nothing else has to.
+//
+//      The frames are only moved around, not freed: there must be free
+//      frames outside the run for its pages.
+//----------------------------------------------------------------------
+
+void
+Pager::Compact ()
+{
+    unsigned int frame, n;
+    int run, target;
+
+    DEBUG ('a', "Compaction, fragmentation %d%%\n",
+	   frameProvider->Fragmentation ());
+    for (n = 0; n < frameProvider->NumRuns (); n++)
+      {
+	  if (frameProvider->Fragmentation () < CompactionThreshold)
+	      return;
+	  run = ChooseRun ();
+	  if (run < 0)
+	      return;
+	  for (frame = run * HugePageFactor;
+	       frame < (unsigned) (run + 1) * HugePageFactor; frame++)
+	    {
+		if (frameProvider->FrameIsFree (frame))
+		    continue;
+		target = frameProvider->GetFrameOutsideRun (run);
+		if (target < 0)
+		    return;	// nowhere to move the page to
+		if (!Migrate (frame, target))
+		  {
+		      frameProvider->ReleaseFrame (target);
+		      break;	// the run changed, choose again
+		  }
+		currentThread->Yield ();
+	    }
+	  if (frameProvider->FreeFramesInRun (run) == HugePageFactor)
+	      stats->numCompactions++;
+      }
+}
+
+//----------------------------------------------------------------------
+// Pager::ChooseVictim
+//      Return the frame to evict, or -1 if none can be.
+//
+//      FIFO takes the page loaded first.  CLOCK sweeps the frames,
+//      giving a second chance to the pages used since the last sweep.
+//      RANDOM picks any evictable frame.
+//
+//      With a TLB, the use bits of the page table are only brought up
+//      to date when the TLB entries are dropped, CLOCK sees them late.
+//      A huge page has a single use bit, in the entry of its first page.
+//----------------------------------------------------------------------
+
+int
+Pager::ChooseVictim ()
+{
+    TranslationEntry *entry;
+    int i, victim = -1, n = 0;
+
+    switch (policy)
+      {
+      case PAGER_FIFO:
+	  for (i = 0; i < NumPhysPages; i++)
+	      if (Evictable (i)
+		  && (victim < 0 || loadTime[i] < loadTime[victim]))
+		  victim = i;
+	  break;
+
+      case PAGER_CLOCK:
+	  // two sweeps at most: the first one clears the use bits
+	  for (i = 0; i < 2 * NumPhysPages; i++)
+	    {
+		victim = hand;
+		hand = (hand + 1) % NumPhysPages;
+		if (!Evictable (victim))
+		    continue;
+		entry = owner[victim]->HugePageEntry (ownerPage[victim]);
+		if (entry == NULL)
+		    entry = owner[victim]->PageEntry (ownerPage[victim]);
+		if (!entry->use)
+		    return victim;
+		entry->use = FALSE;
+	    }
+	  victim = -1;
+	  break;
+
+      case PAGER_RANDOM:
+	  for (i = 0; i < NumPhysPages; i++)
+	      if (Evictable (i))
+		  n++;
+	  if (n == 0)
+	      break;
+	  n = Random () % n;
+	  for (i = 0; i < NumPhysPages; i++)
+	      if (Evictable (i) && n-- == 0)
+		{
+		    victim = i;
+		    break;
+		}
+	  break;
+      }
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// Pager::AllocSwapSlot, Pager::FreeSwapSlot
+//      Manage the swap space, one page per slot.
+//----------------------------------------------------------------------
+
+int
+Pager::AllocSwapSlot ()
+{
+    return swapSlots->Find ();
+}
+
+void
+Pager::FreeSwapSlot (int slot)
+{
+    swapSlots->Clear (slot);
+}
+
+//----------------------------------------------------------------------
+// Pager::DuplicateSwapSlot
+//      Copy the swapped out page in "slot" to a new slot, for the child
+//      of a Fork.  Return -1 if the swap space is full.
+//----------------------------------------------------------------------
+
+int
+Pager::DuplicateSwapSlot (int slot)
+{
+    int copy = AllocSwapSlot ();
+
+    if (copy < 0)
+	return -1;
+    bcopy (&swap[slot * PageSize], &swap[copy * PageSize], PageSize);
+    return copy;
+}
+
+//----------------------------------------------------------------------
+// Pager::WriteSwap, Pager::ReadSwap
+//      Copy a page between "frame" and the swap space.  Each copy costs
+//      as much simulated time as a disk access.
+//----------------------------------------------------------------------
+
+void
+Pager::WriteSwap (int slot, unsigned int frame)
+{
+    bcopy (&machine->mainMemory[frame * PageSize], &swap[slot * PageSize],
+	   PageSize);
+    stats->numPageOuts++;
+    stats->totalTicks += SwapTime;
+    stats->systemTicks += SwapTime;
+}
+
+void
+Pager::ReadSwap (int slot, unsigned int frame)
+{
+    bcopy (&swap[slot * PageSize], &machine->mainMemory[frame * PageSize],
+	   PageSize);
+    stats->numPageIns++;
+    stats->totalTicks += SwapTime;
+    stats->systemTicks += SwapTime;
+}
+
+//----------------------------------------------------------------------
+// Pager::PrintCSV
+//      Print the paging statistics of the run on one line, for
+//      test/vmbench.sh:
+//      vmstats,policy,frames,page size,faults,evictions,page outs,
+//      dirty write-backs,page ins,total ticks
+//----------------------------------------------------------------------
+
+void
+Pager::PrintCSV ()
+{
+    printf ("vmstats,%s,%d,%d,%d,%d,%d,%d,%d,%lld\n", policyNames[policy],
+	    NumPhysPages, PageSize, stats->numPageFaults, stats->numEvictions,
+	    stats->numPageOuts, stats->numDirtyWriteBacks, stats->numPageIns,
+	    stats->totalTicks);
+}
@@ -0,0 +1,88 @@
+// pager.h
+//      Page replacement and swap space.
+//
+//      When no frame is free, the pager takes one back from a page of
+//      some address space, chosen by the replacement policy.  The page
+//      is copied to the swap space (unless an up to date copy is
+//      already there), and brought back on its next page fault.
+//
+//      Only the frames mapped by a single address space can be taken
+//      back; the frames shared after a Fork, or with the executable
+//      cache, stay in memory.
+//
+//      The swap space is kept in host memory, each access to it is
+//      charged SwapTime ticks, as a disk access would be.
+//
+//      The pager also compacts physical memory: when the free frames
+//      are too scattered for huge pages (see FrameProvider), a kernel
+//      thread moves the pages it could evict out of the runs of frames
+//      that are almost free, so that they become entirely free.
+
+#ifndef PAGER_H
+#define PAGER_H
+
+#include "copyright.h"
+#include "bitmap.h"
+
+class AddrSpace;
+
+#define PAGER_FIFO 0		// replacement policies
+#define PAGER_CLOCK 1		// second chance, using the use bits
+#define PAGER_RANDOM 2
+
+#define DefaultNumSwapPages 1024
+#define SwapTime (SeekTime + RotationTime)
+
+class Pager {
+  public:
+    Pager (int replacementPolicy, int numSwap);
+    ~Pager ();
+
+    // Zero-filled frame for page "vpn" of "space", evicting a page if
+    // no frame is free.  Return -1 if nothing can be evicted.  Page
+    // faults can use the reserved frames (see FrameProvider).
+    int GetFrame (AddrSpace *space, unsigned int vpn, bool fromReserve);
+
+    // "space" maps "frame" at "vpn" and is the only one to do so
+    void SetOwner (unsigned int frame, AddrSpace *space, unsigned int vpn);
+    // "space" does not map "frame" anymore, or shares it
+    void Disown (unsigned int frame, AddrSpace *space);
+
+    unsigned int NumEvictableFrames ();
+    unsigned int ResidentFrames (AddrSpace *space); // frames it owns
+    void SwapOut (AddrSpace *space);	// evict all of them
+
+    void StartCompaction ();		// fork the compaction thread
+
+    // Swap space
+    int AllocSwapSlot ();		// -1 if the swap space is full
+    void FreeSwapSlot (int slot);
+    int DuplicateSwapSlot (int slot);	// copy for a forked address space
+    void WriteSwap (int slot, unsigned int frame);
+    void ReadSwap (int slot, unsigned int frame);
+
+    void PrintCSV ();			// one line of paging statistics
+
+  private:
+    int policy;
+    AddrSpace **owner;		// the address space owning each frame,
+    unsigned int *ownerPage;	// the page it maps there
+    unsigned int *loadTime;	// when it did, for FIFO
+    unsigned int clock;
+    int hand;			// next frame to look at, for CLOCK
+
+    int numSwapPages;
+    char *swap;
+    BitMap *swapSlots;
+
+    bool Evictable (unsigned int frame);
+    int ChooseVictim ();
+
+    bool Movable (unsigned int frame);
+    bool Migrate (unsigned int frame, unsigned int target);
+    int ChooseRun ();			// the run to empty, -1 if none
+    void Compact ();
+    static void CompactionThread (int arg);
+};
+
+#endif // PAGER_H
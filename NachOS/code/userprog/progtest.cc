@@ -34,6 +34,7 @@ StartProcess (char *filename)
       }
     space = new AddrSpace (executable);
     currentThread->space = space;
+    admission->Started (space, 0);
 
     delete executable;		// close file
 
@@ -121,7 +122,8 @@ SynchConsoleTest (char *in, char *out)
 
   char ch;
   //char inputstring[5];
-  SynchConsole *synchconsoleLocal = new SynchConsole(in, out);
+  SynchConsole *synchconsoleLocal = new SynchConsole(in, out,
+                                                     DefaultConsoleBurst);
   //Testing few strings
   //synchconsoleLocal->SynchPutString("Wellcome to SynchConsoleTest\n");
   //synchconsoleLocal->SynchPutString("Write at least 5 characters\n");
@@ -3,33 +3,28 @@
 #include "system.h"
 #include "synchconsole.h"
 #include "synch.h"
+#include "donetwork.h"
 
-static Semaphore *readAvail;
-static Semaphore *writeDone;
-//static Semaphore *readConsoleLock;
-//static Semaphore *writeConsoleLock;
-static Semaphore *semGet;
-static Semaphore *semPut;
-static Semaphore *semGetString;
-static Semaphore *semPutString;
-static Semaphore *mainEnd;
+//Each console has its own semaphores, several of them can be in use
+//(see the -vt option)
+static void ConsoleReadAvail(int arg)
+{ ((SynchConsole *) arg)->ReadAvail(); }
+static void ConsoleWriteDone(int arg)
+{ ((SynchConsole *) arg)->WriteDone(); }
 
-static void ReadAvail(int arg) { readAvail->V(); }
-static void WriteDone(int arg) { writeDone->V(); }
-
-SynchConsole::SynchConsole(char *readFile, char *writeFile)
+SynchConsole::SynchConsole(char *readFile, char *writeFile, int burstSize)
 {
     readAvail = new Semaphore("read avail", 0);
     writeDone = new Semaphore("write done", 0);
-    //readConsoleLock = new Semaphore("Console Read avail", 1);
-    //writeConsoleLock = new Semaphore("Console Write Done", 1);
     
     semGet = new Semaphore("Read Char", 1);
     semPut = new Semaphore("Write Char", 1);
     semGetString = new Semaphore(" Read String", 1);
     semPutString = new Semaphore("Write String", 1); 
     mainEnd = new Semaphore("Wait at Main End for other threads to finish",1);
-    console = new Console (readFile, writeFile, ReadAvail, WriteDone, 0);
+    console = new Console (readFile, writeFile, ConsoleReadAvail, ConsoleWriteDone,
+                           (int) this);
+    console->SetBurst(burstSize);
 }
 
 SynchConsole::~SynchConsole()
@@ -37,8 +32,6 @@ SynchConsole::~SynchConsole()
     delete console;
     delete writeDone;
     delete readAvail;
-    //delete readConsoleLock;
-    //delete writeConsoleLock;
     delete semPut;
     delete semGetString;
     delete semPutString;
@@ -48,47 +41,69 @@ SynchConsole::~SynchConsole()
 }
 
 
-void SynchConsole::SynchPutChar(const char ch) {
-    //
-      
-   // writeConsoleLock->P ();    //Lock 
+void SynchConsole::ReadAvail() {
 
-    semPut->P();
+    readAvail->V();
+    WakeSelect();       //a process may wait for this console in Select
 
-     console->PutChar(ch);  //echo it
-     writeDone->P ();
+}
 
-    semPut->V();
-    //writeConsoleLock->V ();
+void SynchConsole::WriteDone() {
 
+    writeDone->V();
+
+}
+
+void SynchConsole::SynchPutChar(const char ch) {
 
+    SynchWrite(&ch, 1);
 
 }
 
 int SynchConsole::SynchGetChar() {
-//
-    int ch;
-    //Acquire the Lock
-     semGet->P();
-    readAvail->P ();  //Wait for character to arrive
-    //ch = (int)console->GetChar();
-    if(console->feof()) {
-            
-            semGet->V();
-            return EOF;
-    }
-    else {
-      ch = console->GetChar();
-      //Release Lock
-      semGet->V();
-      return ch;
+
+    char ch;
+
+    if (SynchRead(&ch, 1) == 0)
+        return EOF;
+    return ch;
+}
+
+//Queue the bytes in the output buffer of the console as room is made,
+//one wakeup per burst sent instead of one per byte, then wait for
+//the last burst so that nothing is lost if the machine halts.
+//readAvail and writeDone may have been V'ed more than once per wait,
+//the conditions are checked again after each wakeup.
+void SynchConsole::SynchWrite(const char *buf, int len) {
+
+    int done = 0;
+
+    semPut->P();
+    while (done < len) {
+        done += console->PutBuffer(buf + done, len - done);
+        if (done < len)
+            writeDone->P();     //wait for room
     }
+    while (!console->OutputIdle())
+        writeDone->P();
+    semPut->V();
+}
 
-    
+int SynchConsole::SynchRead(char *buf, int len) {
+
+    int got;
+
+    semGet->P();
+    while ((got = console->GetBuffer(buf, len)) == 0 && !console->feof())
+        readAvail->P();     //wait for characters to arrive
+    semGet->V();
+    return got;
+}
 
- 
 
-//return ch;
+bool SynchConsole::InputReady() {
+
+    return console->InputReady();
 }
 
 
@@ -126,44 +141,39 @@ void SynchConsole::SynchPutString(const char s[]) {
 // ...
     int i = 0;
     //Acquire Lock to the Buffer
-    //writeConsoleLock->P ();   //Lock 
     semPutString->P();
 
-    while(s[i] != '\0' && i < MAX_STRING_SIZE-1) {
-        SynchPutChar(s[i]);
+    while(s[i] != '\0' && i < MAX_STRING_SIZE-1)
         i++;
-
+    if(s[i] == '\0')
+        SynchWrite(s, i + 1);   //the terminator too, in the same burst
+    else {
+        SynchWrite(s, i);
+        SynchPutChar('\0');
     }
-    SynchPutChar('\0');
 
     semPutString->V();
-  // writeConsoleLock->V ();  // Release lock after finishing writing
 }
 
 void SynchConsole::SynchGetString(char *s, int n) {
 //
-    int i;
-  //char localBuffer[MAX_STRING_SIZE];  //Local buffer
-
+    int i, got;
 
-   //readConsoleLock->P ();   //Lock 
+    semGetString->P();
 
-      semGetString->P();
-
-    for(i=0; i < n-1 ; i++) {
-        s[i] = SynchGetChar();
-
-        if (s[i] == EOF )
-          break;
-        if(s[i] == '\n' || s[i] == '\0')
+    //SynchRead stops after a newline or a '\0', which are dropped
+    for(i = 0; i < n-1; i += got) {
+        got = SynchRead(&s[i], n-1-i);
+        if (got == 0)
+            break;      //end of the input
+        if (s[i+got-1] == '\n' || s[i+got-1] == '\0') {
+            i += got-1;
             break;
+        }
     }
     s[i] = '\0';
 
-
-   //readConsoleLock->V ();
-
-      semGetString->V();
+    semGetString->V();
 
 }
 
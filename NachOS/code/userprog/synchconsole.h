@@ -5,15 +5,26 @@
 #include "utility.h"
 #include "console.h"
 
+class Semaphore;
+
+#define DefaultConsoleBurst 16	// chars moved per console interrupt
+
 class SynchConsole {
     public:
-        SynchConsole(char *readFile, char *writeFile);
-        // initialize the hardware console device
+        SynchConsole(char *readFile, char *writeFile, int burstSize);
+        // initialize the hardware console device, moving "burstSize"
+        // chars per interrupt
         ~SynchConsole(); // clean up console emulation
         void SynchPutChar(const char ch); // Unix putchar(3S)
         int SynchGetChar(); // Unix getchar(3S)
         void SynchPutString(const char *s); // Unix puts(3S)
         void SynchGetString(char *s, int n); // Unix fgets(3S)
+        // Bulk transfers.  SynchWrite returns once "len" bytes are on
+        // the display; SynchRead waits for at least one byte, and
+        // returns at most one line, 0 at the end of the input.
+        void SynchWrite(const char *buf, int len);
+        int SynchRead(char *buf, int len);
+        bool InputReady(); // SynchRead would not wait
         //Reads from Memory
        static  void copyStringFromMachine( int from, char *to, unsigned size);  
         // Writes To Memory
@@ -24,10 +35,19 @@ class SynchConsole {
         void threadCreateSem();
         void threadDestroySem();
 
-
+        // internal, called by the console interrupt handlers
+        void ReadAvail();
+        void WriteDone();
 
     private:
         Console *console;
+        Semaphore *readAvail;
+        Semaphore *writeDone;
+        Semaphore *semGet;
+        Semaphore *semPut;
+        Semaphore *semGetString;
+        Semaphore *semPutString;
+        Semaphore *mainEnd;
 };
 
 #endif // SYNCHCONSOLE_H
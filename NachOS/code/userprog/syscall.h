@@ -55,6 +55,27 @@
 #define SC_SemInit 34
 #define SC_SemP 35
 #define SC_SemV 36
+#define SC_UserThreadDetach 37
+#define SC_Mmap 38
+#define SC_Munmap 39
+#define SC_Sbrk 40
+#define SC_ForkExecTerm 41
+#define SC_PortOpen 42
+#define SC_PortClose 43
+#define SC_PortSend 44
+#define SC_PortReceive 45
+#define SC_Select 46
+
+/* Flags of PortOpen */
+#define PORT_NONBLOCK 1		/* PortReceive does not wait */
+
+/* Returned by PortReceive on a non-blocking port with no message */
+#define PORT_EMPTY (-2)
+
+/* Kinds of the entries of Select */
+#define SELECT_PORT 0		/* a message can be received */
+#define SELECT_FILE 1		/* an open file (always ready) */
+#define SELECT_CONSOLE 2	/* the terminal of the process has input */
 
 
 #ifdef IN_USER_MODE
@@ -149,10 +170,11 @@ void SemV(sem_t *semID );
  * threads to run within a user program.
  */
 
-/* Fork a thread to run a procedure ("func") in the *same* address space
- * as the current thread.
+/* Duplicate the current process, Unix style.  Memory is shared
+ * copy-on-write with the parent.  Return the pid of the child (to be
+ * used with UserWaitPid) in the parent, 0 in the child, -1 on error.
  */
-void Fork (void (*func) ());
+int Fork ();
 
 /* Yield the CPU to another runnable thread, whether in this address space
  * or not.
@@ -172,18 +194,28 @@ void GetInt( int *n);
 //Returns integre value if it succeeds otherwise returns null
 int UserThreadCreate(void f(void *arg), void *arg);
 
-void UserThreadExit();
+void UserThreadExit(int status);
 
 
 
 /*TreadCreate Syscall*/
 int UserThreadCreate(void f(void *arg), void *arg);
-void UserThreadExit();
-void UserThreadJoin(int tid);
+/* A thread returning from f exits with the returned value as status,
+ * UserThreadExit(status) with "status" */
+void UserThreadExit(int status);
+/* Wait for thread tid and return its exit status, -1 if it cannot be
+ * joined (unknown, detached or already joined) */
+int UserThreadJoin(int tid);
+/* Nobody will join thread tid, its resources are freed when it exits */
+int UserThreadDetach(int tid);
 
 
 /*ForkExec Syscall*/
 int ForkExec(char *s);
+/* Same, the process running on terminal "terminal" (see the -vt
+ * option) instead of the terminal of its parent.  -1 if there is no
+ * such terminal */
+int ForkExecTerm(char *s, int terminal);
 void UserWaitPid(int pid);
 
 /*Filesys Syscalls*/
@@ -199,6 +231,51 @@ int read(int fileDescriptor, int count);
 int write(int fileDescriptor, const char* buf, int size);
 int close(int fileDescriptor);
 int lseek(int fileDescriptor, int offset);
+/* Map "length" bytes of the open file fileDescriptor, from "offset",
+ * in the address space.  The pages are read from the file on first
+ * access, and the modified ones written back by Munmap or on Exit.
+ * Return the address of the mapping, or -1 on error */
+void *Mmap(int fileDescriptor, int offset, int length);
+/* Remove the mapping at addr, return 0, or -1 if there is none */
+int Munmap(void *addr);
+
+/* Move the end of the heap by increment bytes (it starts right after
+ * the uninitialized data, see test/malloc.c).  Return the previous end,
+ * or -1 if there is no room */
+void *Sbrk(int increment);
+
+/* Network ports (kernels with network support only, see the -m flag).
+ * A port receives the messages sent to mailbox "box" of this machine,
+ * and sends messages from it.  Messages are datagrams of at most the
+ * MTU less the headers (about 50 bytes with the default -mtu), they
+ * can be lost if the network is unreliable (-l). */
+typedef struct {
+  int machine;			/* network address of the machine */
+  int box;			/* mailbox on it */
+} PortAddress;
+
+/* Open a port on mailbox "box", flags PORT_NONBLOCK or 0.  Return its
+ * number, or -1 if the box is taken or out of range */
+int PortOpen(int box, int flags);
+int PortClose(int port);
+/* Send "size" bytes of "buf" to "to".  Return "size", or -1 if the
+ * message is too large or "to" names no possible machine or mailbox */
+int PortSend(int port, const PortAddress *to, const char *buf, int size);
+/* Receive a message in "buf", truncated to "size" bytes, and store its
+ * sender in "from" (if not NULL).  Return the number of bytes stored
+ * in "buf", PORT_EMPTY if
+ * the port is non-blocking and no message is there, -1 on error */
+int PortReceive(int port, PortAddress *from, char *buf, int size);
+
+/* Wait until one of the "numEntries" entries is ready, or "timeout"
+ * ticks (-1: no limit, 0: just check).  "ready" is set in each entry;
+ * return the number of ready ones, 0 on timeout, -1 on error */
+typedef struct {
+  int kind;			/* SELECT_PORT, SELECT_FILE, SELECT_CONSOLE */
+  int id;			/* port or file descriptor */
+  int ready;			/* set by Select */
+} SelectEntry;
+int Select(SelectEntry *entries, int numEntries, int timeout);
 
 
 
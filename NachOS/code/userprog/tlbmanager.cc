@@ -0,0 +1,158 @@
+// tlbmanager.cc
+//      Routines to refill and invalidate the TLB.
+
+#include "copyright.h"
+#include "system.h"
+#include "tlbmanager.h"
+
+//----------------------------------------------------------------------
+// TLBManager::TLBManager
+//      Initialize the kernel side of the TLB.  "replacementPolicy" is
+//      TLB_RANDOM or TLB_LRU.
+//----------------------------------------------------------------------
+
+TLBManager::TLBManager (int replacementPolicy)
+{
+    int i;
+
+    policy = replacementPolicy;
+    asids = new BitMap (NumAsids);
+    source = new TranslationEntry *[tlbSize];
+    for (i = 0; i < tlbSize; i++)
+	source[i] = NULL;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::~TLBManager
+//----------------------------------------------------------------------
+
+TLBManager::~TLBManager ()
+{
+    delete asids;
+    delete [] source;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::AllocAsid
+//      Give a new address space its id.
+//----------------------------------------------------------------------
+
+unsigned int
+TLBManager::AllocAsid ()
+{
+    int asid = asids->Find ();
+
+    ASSERT (asid >= 0);
+    return asid;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::FreeAsid
+//      The address space is destroyed, its id can be reused.
+//----------------------------------------------------------------------
+
+void
+TLBManager::FreeAsid (unsigned int asid)
+{
+    Flush (asid);
+    asids->Clear (asid);
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Refill
+//      Handle a TLB miss on the page described by "entry".  The page
+//      goes in an invalid entry of its set if there is one, otherwise
+//      in the one chosen by the replacement policy.
+//----------------------------------------------------------------------
+
+void
+TLBManager::Refill (unsigned int asid, TranslationEntry *entry)
+{
+    int slot = ChooseVictim (entry->virtualPage);
+
+    DEBUG ('a', "TLB refill of virtual page %d (asid %d) in entry %d\n",
+	   entry->virtualPage, asid, slot);
+    Drop (slot);
+    machine->tlb[slot] = *entry;
+    machine->tlb[slot].asid = asid;
+    machine->tlbLastUse[slot] = ++machine->tlbClock;
+    source[slot] = entry;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Invalidate
+//      Drop the TLB copy of "vpn" in address space "asid", if any.
+//----------------------------------------------------------------------
+
+void
+TLBManager::Invalidate (unsigned int asid, unsigned int vpn)
+{
+    int set = vpn % machine->tlbNumSets;
+    int i;
+
+    for (i = set * machine->tlbNumWays; i < (set + 1) * machine->tlbNumWays;
+	 i++)
+	if (machine->tlb[i].valid && machine->tlb[i].asid == asid
+	    && machine->tlb[i].virtualPage == vpn)
+	    Drop (i);
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Flush
+//      Drop every TLB entry of address space "asid".
+//----------------------------------------------------------------------
+
+void
+TLBManager::Flush (unsigned int asid)
+{
+    int i;
+
+    for (i = 0; i < tlbSize; i++)
+	if (machine->tlb[i].valid && machine->tlb[i].asid == asid)
+	    Drop (i);
+}
+
+//----------------------------------------------------------------------
+// TLBManager::ChooseVictim
+//      Return the TLB entry in which to load "vpn".
+//----------------------------------------------------------------------
+
+int
+TLBManager::ChooseVictim (unsigned int vpn)
+{
+    int first = (vpn % machine->tlbNumSets) * machine->tlbNumWays;
+    int i, victim;
+
+    for (i = first; i < first + machine->tlbNumWays; i++)
+	if (!machine->tlb[i].valid)
+	    return i;
+
+    if (policy == TLB_RANDOM)
+	return first + Random () % machine->tlbNumWays;
+
+    victim = first;
+    for (i = first + 1; i < first + machine->tlbNumWays; i++)
+	if (machine->tlbLastUse[i] < machine->tlbLastUse[victim])
+	    victim = i;
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Drop
+//      Invalidate TLB entry "slot", giving its use and dirty bits back
+//      to the page table.
+//----------------------------------------------------------------------
+
+void
+TLBManager::Drop (int slot)
+{
+    TranslationEntry *entry = &machine->tlb[slot];
+
+    if (entry->valid && source[slot] != NULL)
+      {
+	  source[slot]->use |= entry->use;
+	  source[slot]->dirty |= entry->dirty;
+      }
+    entry->valid = FALSE;
+    source[slot] = NULL;
+}
@@ -0,0 +1,54 @@
+// tlbmanager.h
+//      Kernel management of the software-loaded TLB (USE_TLB kernels).
+//
+//      On a TLB miss, the machine raises a PageFaultException and the
+//      kernel loads the translation from the page table of the current
+//      address space.  TLB entries are tagged with the address space id
+//      (ASID) of their owner, so that a context switch does not need to
+//      flush the TLB: they are only invalidated when the page table
+//      entry they copy changes, or when the address space goes away.
+
+#ifndef TLBMANAGER_H
+#define TLBMANAGER_H
+
+#include "copyright.h"
+#include "translate.h"
+#include "bitmap.h"
+
+#define NumAsids	256	// at most one per live process
+#define NoAsid		NumAsids	// of an address space that gave
+					// its own back
+
+#define TLB_RANDOM 0		// replacement policies
+#define TLB_LRU 1
+
+class TLBManager {
+  public:
+    TLBManager (int replacementPolicy);
+    ~TLBManager ();
+
+    unsigned int AllocAsid ();
+    void FreeAsid (unsigned int asid);	// also flushes its entries
+
+    // Load "entry", the page table entry of a page of address space
+    // "asid", in the TLB
+    void Refill (unsigned int asid, TranslationEntry *entry);
+
+    // The page table entry of "vpn" changed, drop its copy
+    void Invalidate (unsigned int asid, unsigned int vpn);
+
+    // Drop every entry of "asid"
+    void Flush (unsigned int asid);
+
+  private:
+    int policy;
+    BitMap *asids;		// ids in use
+    TranslationEntry **source;	// page table entry each TLB entry was
+				// loaded from, to give its use and dirty
+				// bits back when it is dropped
+
+    int ChooseVictim (unsigned int vpn);
+    void Drop (int slot);
+};
+
+#endif // TLBMANAGER_H
@@ -1,6 +1,7 @@
 #include "copyright.h"
 #include "userthread.h"
 #include "synchconsole.h"
+#include "donetwork.h"
 
 
 
@@ -13,6 +14,8 @@ static void StartUserThread (int f){
 	int function = func_and_arg->f;
 	int argument = func_and_arg->arg;
 	int sp = func_and_arg->sp;
+	int exitAddr = func_and_arg->exit;
+	delete func_and_arg;
 
 	//Lets clear all the registers of the machine
 	for (i = 0; i < NumTotalRegs; i++)
@@ -25,6 +28,9 @@ static void StartUserThread (int f){
     machine->WriteRegister (PCReg, function);
     machine->WriteRegister (NextPCReg, function+4);
 
+    // Returning from the function goes through UserThreadExit
+    machine->WriteRegister (RetAddrReg, exitAddr);
+
     // Set the stack register 2 or 3 pages below the pointer to the main program
     machine->WriteRegister (StackReg, sp);
 
@@ -73,66 +79,78 @@ void do_UserSemV(int semAddress)
 	currentThread->space->userSemaphores[value]->V();
 
 }
-int do_UserThreadCreate(int f, int arg){
+int do_UserThreadCreate(int f, int arg, int exitAddr){
+
+	AddrSpace *space = currentThread->space;
 
-	if((currentThread->space->tidcounter+1)*ThreadStackSize >= UserStackSize){
+	space->lock_threads->P();
+	UserThreadEntry *entry = space->AddUserThread();
+	if(entry == NULL){
+		space->lock_threads->V();
 		printf ("Not enough space to allocate stack for thread\n");
 		return -1;
 	}
-
-	currentThread->space->lock_livethreads->P();
-	currentThread->space->livethreads++;
-	currentThread->space->lock_livethreads->V();
-
-	currentThread->space->lock_tidcounter->P();
-
-	currentThread->space->tidcounter++;
-	int this_tid = currentThread->space->tidcounter;
-	
-	
-	currentThread->space->activeThreads[this_tid] = currentThread->tid;
-	currentThread->space->lock_tidcounter->V();
-	unsigned int numPages = currentThread->space->GetNumPages();
+	space->livethreads++;
+	int this_tid = entry->tid;
+	space->lock_threads->V();
 
 	//Put arguments and function in a structure so they can be sent to fork()
 	threadArgs_t *func_and_arg = new threadArgs_t;
 	func_and_arg->f = f;
 	func_and_arg->arg = arg;
-	func_and_arg->sp = numPages*PageSize - this_tid*ThreadStackSize-8;
+	func_and_arg->sp = space->UserThreadStackTop(entry->stackSlot);
+	func_and_arg->exit = exitAddr;
 
 	//Create the thread
     Thread *t = new Thread ("User thread");
-    t->Fork (StartUserThread, (int)(func_and_arg));
 	t->tid = this_tid;
+    t->Fork (StartUserThread, (int)(func_and_arg));
 	
 	DEBUG ('t', "UserThread calling funtion %d created.\n", f);
 
     return this_tid;
 }
 
-void do_UserThreadExit(){
+void do_UserThreadExit(int status){
 	DEBUG ('t', "UserThread finished.\n");
 
-	currentThread->space->lock_livethreads->P();
-	currentThread->space->livethreads--;
-	currentThread->space->lock_livethreads->V();
+	AddrSpace *space = currentThread->space;
+
+	space->lock_threads->P();
+	UserThreadEntry *entry = space->FindUserThread(currentThread->tid);
+	ASSERT(entry != NULL);
+	entry->exitStatus = status;
+	entry->finished = TRUE;
+
+	//The user stack is not needed anymore, another thread can take it
+	space->ReleaseStackSlot(entry);
+
+	//Wake up every joiner, the last one to leave reaps the entry
+	for(int i = 0; i < entry->numWaiters; i++)
+		entry->joinSem->V();
+	if(entry->detached)
+		space->RemoveUserThread(entry);
 
-	int this_tid = currentThread->tid;
-	currentThread->space->createdThreads[this_tid]->V();
+	space->livethreads--;
+	if(space->livethreads == 0 && space->exiting)
+		space->allThreadsDone->V();
+	space->lock_threads->V();
 
 	currentThread->Finish();	
 }
 
 void do_Exit(){
-	//Check if all threads in this address space are done
-	currentThread->space->lock_livethreads->P();
-	while(currentThread->space->livethreads > 0)
-	{
-		currentThread->space->lock_livethreads->V();	
-		currentThread->Yield();
-		currentThread->space->lock_livethreads->P();
+	//Wait for all threads in this address space to be done
+	AddrSpace *space = currentThread->space;
+
+	space->lock_threads->P();
+	if(space->livethreads > 0){
+		space->exiting = TRUE;
+		space->lock_threads->V();
+		space->allThreadsDone->P();
 	}
-	currentThread->space->lock_livethreads->V();
+	else
+		space->lock_threads->V();
 
 	//Signal in case a Process is waiting this Process to finish
 	int this_pro = currentThread->space->pro;
@@ -148,16 +166,82 @@ void do_Exit(){
 		//Delete entries that belong to the ending process
 		fileSystem->DeleteEntriesOfProcess(currentThread->space->pro); 
 		#endif // NOT FILESYS_STUB
+		ClosePorts(currentThread->space);
 		
 		currentThread->space->FreeFrames();	  //Free memory
+		admission->Exited(currentThread->space); //let queued ones run
 		currentThread->Finish();
 	}
 	lock_livepro->V();
 
 }
 
-void do_UserThreadJoin(int arg){
-	currentThread->space->createdThreads[arg]->P();
-	currentThread->space->createdThreads[arg]->V();
+// End the process of the current thread: it faulted, or it is a user
+// thread calling Exit (it cannot wait in do_Exit for itself).  A user
+// thread finishes through UserThreadExit, and the main thread runs the
+// exit once the others are done: they see "killed" the next time they
+// enter the kernel, and finish too.  Does not return.
+void do_Kill(){
+
+	AddrSpace *space = currentThread->space;
+
+	space->lock_threads->P();
+	space->killed = TRUE;
+	UserThreadEntry *entry = space->FindUserThread(currentThread->tid);
+	space->lock_threads->V();
+
+	if(entry != NULL)
+		do_UserThreadExit(-1);
+	do_Exit();
+	interrupt->Halt();	//this was the last process
+}
+
+// Wait for thread "tid" of the current address space and return its
+// exit status, or -1 if there is no such thread to join (unknown tid,
+// detached, already joined or the caller itself).
+int do_UserThreadJoin(int tid){
+
+	AddrSpace *space = currentThread->space;
+	int status;
+
+	space->lock_threads->P();
+	UserThreadEntry *entry = space->FindUserThread(tid);
+	if(entry == NULL || entry->detached || tid == currentThread->tid){
+		space->lock_threads->V();
+		return -1;
+	}
+	if(!entry->finished){
+		entry->numWaiters++;
+		space->lock_threads->V();
+		entry->joinSem->P();
+		space->lock_threads->P();
+		entry->numWaiters--;
+	}
+	status = entry->exitStatus;
+	if(entry->numWaiters == 0)
+		space->RemoveUserThread(entry);
+	space->lock_threads->V();
+
+	return status;
 }
 
+// Nobody will join thread "tid": its entry is dropped as soon as it
+// finishes.  Return 0, or -1 if it cannot be detached.
+int do_UserThreadDetach(int tid){
+
+	AddrSpace *space = currentThread->space;
+
+	space->lock_threads->P();
+	UserThreadEntry *entry = space->FindUserThread(tid);
+	if(entry == NULL || entry->detached || entry->numWaiters > 0){
+		space->lock_threads->V();
+		return -1;
+	}
+	if(entry->finished)
+		space->RemoveUserThread(entry);
+	else
+		entry->detached = TRUE;
+	space->lock_threads->V();
+
+	return 0;
+}
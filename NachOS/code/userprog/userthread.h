@@ -6,13 +6,15 @@ typedef struct threadArgs
 	int f;
 	int arg;	
 	int sp;
-	//int exit; //used to define the default return address
+	int exit; //used to define the default return address
 }threadArgs_t;
 
 extern void do_Exit();
-extern void do_UserThreadJoin(int arg);
-extern int do_UserThreadCreate(int f, int arg);
-extern void do_UserThreadExit();
+extern void do_Kill();
+extern int do_UserThreadJoin(int tid);
+extern int do_UserThreadDetach(int tid);
+extern int do_UserThreadCreate(int f, int arg, int exitAddr);
+extern void do_UserThreadExit(int status);
 extern void do_UserSemInit(int semID, int semCounter);
 extern void do_UserSemP(int semID);
 extern void do_UserSemV(int semID);